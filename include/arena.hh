@@ -0,0 +1,52 @@
+#pragma once
+
+#include <atomic>
+#include <memory>
+
+namespace eris {
+
+/// Hands out memory from one block front to back. Allocations are offsets
+/// from the start of the block, half the size of pointers, and nothing is
+/// freed but everything at once. Offset 0 is never handed out and stands
+/// for none. Threads may allocate at once, each bumps the end atomically.
+class Arena {
+public:
+  static constexpr usize ALIGN = 8;
+  /// Offsets are 32 bits.
+  static constexpr usize MAX_BYTES = usize(1) << 32;
+
+  explicit Arena(usize bytes = 0);
+  DISALLOW_COPY_AND_ASSIGN(Arena);
+
+  /// Reallocates the arena to `bytes`, dropping everything in it.
+  auto resize(usize bytes) -> void;
+  auto clear() -> void { _used = ALIGN; }
+
+  /// Offset of `bytes` fresh bytes, 0 when they do not fit.
+  auto allocate(usize bytes) -> u32 {
+    bytes = (bytes + ALIGN - 1) & ~(ALIGN - 1);
+    auto offset = _used.fetch_add(bytes, std::memory_order_relaxed);
+    if (offset + bytes > _capacity) {
+      return 0;
+    }
+    return u32(offset);
+  }
+
+  template <typename T>
+  auto at(u32 offset) const -> T* {
+    return reinterpret_cast<T*>(_memory.get() + offset);
+  }
+
+  auto used() const -> usize {
+    return std::min(_used.load(std::memory_order_relaxed), _capacity);
+  }
+  auto capacity() const -> usize { return _capacity; }
+
+private:
+  std::unique_ptr<std::byte[]> _memory;
+  usize _capacity = 0;
+  /// Past the capacity once an allocation did not fit.
+  std::atomic<usize> _used = ALIGN;
+};
+
+} // namespace eris
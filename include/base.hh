@@ -84,17 +84,19 @@ using f32 = float;
 using f64 = double;
 using Location = std::experimental::source_location;
 
+/// Whole nanoseconds, exact for any run; an `f32` already rounds away
+/// nanoseconds past 16 ms.
 class duration {
 public:
-  duration(f32 d) : _duration_ns(d) {}
+  duration(i64 d) : _duration_ns(d) {}
 
-  auto nanos() const -> f32 { return _duration_ns; }
-  auto micros() const -> f32 { return _duration_ns / 1000.0f; }
-  auto millis() const -> f32 { return _duration_ns / 1000000.0f; }
-  auto secs() const -> f32 { return _duration_ns / 1000000000.0f; }
+  auto nanos() const -> f64 { return f64(_duration_ns); }
+  auto micros() const -> f64 { return f64(_duration_ns) / 1e3; }
+  auto millis() const -> f64 { return f64(_duration_ns) / 1e6; }
+  auto secs() const -> f64 { return f64(_duration_ns) / 1e9; }
 
 private:
-  f32 _duration_ns;
+  i64 _duration_ns;
 };
 
 template <typename A, typename B>
@@ -126,15 +128,28 @@ auto __panic(Location loc, fmt::format_string<T...> fmt, T&&... args) {
 template <typename T, usize N>
 class ArrayVec {
 public:
+  // user-provided so that `ArrayVec()` does not zero the whole buffer
+  ArrayVec() {}
+
   auto operator*() -> T* { return _end; }
   auto operator[](usize idx) const -> T { return _inner[idx]; }
+  auto operator[](usize idx) -> T& { return _inner[idx]; }
   auto begin() const -> const T* { return _inner; }
   auto end() const -> const T* { return _end; }
   auto push_back(T v) -> void {
     ASSERT(size() < N);
     *_end++ = v;
   }
+  /// Reserves `n` slots at the end and returns the first one for the caller to
+  /// fill.
+  auto append(usize n) -> T* {
+    ASSERT(size() + n <= N);
+    auto slots = _end;
+    _end += n;
+    return slots;
+  }
   auto size() const -> usize { return usize(_end - _inner); }
+  auto clear() -> void { _end = _inner; }
 
 private:
   T _inner[N];
@@ -4,7 +4,7 @@ namespace eris {
 
 inline auto nbitmask(int n) -> u64 {
   ASSERT(n >= 0 and n <= 64);
-  return ~0ULL >> (64 - n);
+  return n ? ~0ULL >> (64 - n) : 0ULL;
 }
 
 inline auto lsb(u64 n) -> int {
@@ -20,6 +20,19 @@ inline auto lsb(u64 n) -> int {
 #endif
 }
 
+inline auto msb(u64 n) -> int {
+  ASSERT(n);
+#if defined(__GNUC__)
+  return 63 - __builtin_clzll(n);
+#elif defined(_MSC_VER)
+  unsigned long idx;
+  _BitScanReverse64(&idx, n);
+  return idx;
+#else
+  static_assert(false, "unsupported compiler");
+#endif
+}
+
 inline auto popcnt(u64 bits) -> int {
 #if defined(__GNUC__)
   return __builtin_popcountll(bits);
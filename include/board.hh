@@ -1,19 +1,37 @@
 #pragma once
 
+#include <array>
+
 #include "bitboard.hh"
+#include "groups.hh"
 #include "move.hh"
+#include "road.hh"
 #include "stack.hh"
+#include "stats.hh"
 #include "tables.hh"
 #include "types.hh"
+#include "weights.hh"
+#include "zobrist.hh"
 
 namespace eris {
 
-static constexpr u8 starting_stones[] = { 10, 15, 21, 30, 40, 50 };
-static constexpr u8 starting_caps[] = { 0, 0, 1, 1, 2, 2 };
+struct MoveCount {
+  usize placements = 0;
+  usize spreads = 0;
+  /// Spreads that end with a capstone flattening a wall.
+  usize smashes = 0;
+
+  auto total() const -> usize { return placements + spreads + smashes; }
+};
 
+/// Laid out as columns rather than an array of `Stack`s: the bitboards and
+/// the per-move state share the first cache line, followed by the top stones,
+/// the stack heights and the stack bits, so each is packed without padding.
 template <int Size>
-class Board {
+class alignas(64) Board {
 public:
+  using Stack = StackOf<Size>;
+
   constexpr Board() noexcept = default;
 
   static auto from(const std::string& tps) -> Board {
@@ -27,12 +45,33 @@ public:
   auto top(Square<Size> sq) const -> Stone { return _top[*sq]; }
   auto top(usize idx) const -> Stone { return _top[idx]; }
 
-  auto stack() const -> const Stack* { return _stack; }
-  auto stack(Square<Size> sq) const -> Stack { return _stack[*sq]; }
-  auto stack(usize idx) const -> Stack { return _stack[idx]; }
+  auto stack() const -> std::array<Stack, usize(Size * Size)> {
+    auto stacks = std::array<Stack, usize(Size * Size)>();
+    for (usize i = 0; i < stacks.size(); ++i) { stacks[i] = stack(i); }
+    return stacks;
+  }
+  auto stack(Square<Size> sq) const -> Stack { return stack(*sq); }
+  auto stack(usize idx) const -> Stack {
+    return Stack(_stack[idx], _height[idx]);
+  }
+
+  auto height(Square<Size> sq) const -> int { return _height[*sq]; }
+
+  /// Compares positions, ignoring how they were reached.
+  auto operator==(const Board& other) const -> bool {
+    return rng::equal(_colors, other._colors) and
+           rng::equal(_stones, other._stones) and
+           rng::equal(_top, other._top) and
+           rng::equal(_height, other._height) and
+           rng::equal(_stack, other._stack) and
+           rng::equal(_nstones, other._nstones) and
+           rng::equal(_ncaps, other._ncaps) and _turn == other._turn and
+           _movecount == other._movecount;
+  }
 
   static constexpr auto size() -> usize { return Size; }
   auto movecount() const -> int { return _movecount; }
+  auto hash() const -> u64 { return _hash; }
   auto first_move() const -> bool { return _movecount == 0 or _movecount == 1; }
 
   template <StoneType St, Color C>
@@ -52,7 +91,7 @@ public:
   }
 
   auto stones(StoneType st, Color c) const -> Bitboard {
-    return _stones[st] & _colors[c];
+    return stones(st) & _colors[c];
   }
 
   template <StoneType St>
@@ -60,7 +99,10 @@ public:
     return stones(St);
   }
 
-  auto stones(StoneType st) const -> Bitboard { return _stones[st]; }
+  auto stones(StoneType st) const -> Bitboard {
+    ASSERT(st != NO_STONE_TYPE);
+    return _stones[st - 1];
+  }
 
   constexpr auto stones() const -> Bitboard { return stones<BLACK, WHITE>(); }
 
@@ -75,70 +117,85 @@ public:
   }
 
   template <Color C>
-  auto road() -> bool {
-    auto grid = stones<FLAT, C>() | stones<CAP, C>();
-    constexpr auto side = [](auto fn) {
-      auto m = Bitboard();
-      for (int i = 0; i < Size * Size; ++i) {
-        auto square = Square<Size>(i);
-        if (fn(square)) {
-          m |= square;
-        }
-      }
-      return m;
-    };
+  auto road() const -> bool {
+    stats::count(stats::ROAD);
+    return Groups<Size>::has_road(*road_squares(C));
+  }
 
-    constexpr auto BOTTOM = side([](auto s) { return s.rank() == 0; });
-    constexpr auto TOP = side([](auto s) { return s.rank() == Size - 1; });
-    constexpr auto LEFT = side([](auto s) { return s.file() == 0; });
-    constexpr auto RIGHT = side([](auto s) { return s.file() == Size - 1; });
-
-    auto flood = [&](Bitboard start, Bitboard goal) -> bool {
-      auto reach = start & grid;
-      auto old = Bitboard();
-      while (reach != old) {
-        old = reach;
-        auto up = reach << Size;
-        auto down = reach >> Size;
-        auto left = (reach >> 1) & ~RIGHT;
-        auto right = (reach << 1) & ~LEFT;
-        reach |= (up | down | left | right) & grid;
-      }
-      return (reach & goal) != 0;
-    };
+  auto road() const -> bool { return road<WHITE>() or road<BLACK>(); }
 
-    return flood(TOP, BOTTOM) or flood(LEFT, RIGHT);
+  auto road(Color c) const -> bool {
+    return c == WHITE ? road<WHITE>() : road<BLACK>();
   }
 
-  auto road() -> bool { return road<WHITE>() or road<BLACK>(); }
+  /// Connected flats and capstones of `c`, flooded from the board.
+  auto groups(Color c) const -> Groups<Size> {
+    return Groups<Size>(road_squares(c));
+  }
 
-  auto put_stone(Stone st, Square<Size> sq) -> void {
-    auto idx = *sq;
-    if (not _top[idx]) {
-      _replace_stone_at_top(st, sq);
-      return;
-    }
+  /// Flats and capstones of `c`, the squares its roads run over.
+  auto road_squares(Color c) const -> Bitboard {
+    return stones(c) & ~stones<WALL>();
+  }
 
-    auto sty = stone_type(_top[idx]);
-    ASSERT(sty == FLAT, "`{}` found at \"{}\"", sty, sq);
-    _stack[idx].push(stone_color(_top[idx]));
-    _replace_stone_at_top(st, sq);
+  /// What `roads<Size>` needs to check this board from scratch.
+  auto road_squares() const -> RoadSquares {
+    auto road = RoadSquares();
+    road.squares[WHITE] = road_squares(WHITE);
+    road.squares[BLACK] = road_squares(BLACK);
+    return road;
   }
 
-  auto take_stone(Square<Size> sq) -> Stone {
-    auto idx = *sq;
-    if (not _top[idx]) {
-      return NO_STONE;
+  /// Empty squares where a flat or capstone of `C` completes a road, none
+  /// when `C` has nothing left to place. Those are the squares next to, or on
+  /// the edge beyond, both the groups on one edge and the groups on the edge
+  /// opposite it. The road squares must already cover all ranks or files but
+  /// one, else nothing is flooded.
+  template <Color C>
+  auto road_placements() const -> Bitboard {
+    using G = Groups<Size>;
+    const auto own = *road_squares(C);
+    if ((not _nstones[C] and not _ncaps[C]) or G::extent(own) < Size - 1) {
+      return Bitboard();
     }
 
-    auto st = _top[idx];
-    if (not _stack[idx].height()) {
-      _replace_stone_at_top(NO_STONE, sq);
-      return st;
+    auto beyond = [&](u64 edge) {
+      return G::grow(G::flood(own & edge, own)) | edge;
+    };
+    auto vertical = beyond(G::BOTTOM) & beyond(G::TOP);
+    auto horizontal = beyond(G::LEFT) & beyond(G::RIGHT);
+    return (vertical | horizontal) & *~stones() & nbitmask(Size * Size);
+  }
+
+  auto road_placements(Color c) const -> Bitboard {
+    return c == WHITE ? road_placements<WHITE>() : road_placements<BLACK>();
+  }
+
+  /// Appends the spreads that give the side to move a road. Each candidate's
+  /// road squares are worked out on bitboards rather than by making it, and
+  /// lines that could not make a road with every square they reach are not
+  /// looked at.
+  auto road_spreads(MoveList<Size>& moves) const -> void {
+    road_spreads(_turn, moves);
+  }
+
+  /// The spreads that would give `c` a road were it `c`'s turn, what `c`
+  /// threatens while the other side is to move.
+  auto road_spreads(Color c, MoveList<Size>& moves) const -> void {
+    if (first_move()) {
+      return;
     }
+    c == WHITE ? _road_spreads<WHITE>(moves) : _road_spreads<BLACK>(moves);
+  }
 
-    auto new_top_stone = mk_stone(FLAT, _stack[idx].pop());
-    _replace_stone_at_top(new_top_stone, sq);
+  auto put_stone(Stone st, Square<Size> sq) -> void {
+    _put_stone(st, sq);
+    _rescore(sq.as_board());
+  }
+
+  auto take_stone(Square<Size> sq) -> Stone {
+    auto st = _take_stone(sq);
+    _rescore(sq.as_board());
     return st;
   }
 
@@ -147,9 +204,10 @@ public:
     ASSERT(square.ok());
     const auto us = first_move() ? ~_turn : _turn;
     if (move.is_place()) {
+      stats::count(stats::MAKE_PLACE);
       auto stone = mk_stone(move.stone(), us);
       ASSERT(_top[*square] == NO_STONE);
-      put_stone(stone, square);
+      _put_stone(stone, square);
       if (move.stone() == CAP) {
         ASSERT(_ncaps[us] > 0);
         _ncaps[us] -= 1;
@@ -157,7 +215,9 @@ public:
         ASSERT(_nstones[us] > 0);
         _nstones[us] -= 1;
       }
+      _smashes <<= 1;
     } else {
+      stats::count(stats::MAKE_SPREAD);
       auto origin = square;
       auto direction = move.direction();
       auto spread = move.spread_pattern();
@@ -168,7 +228,7 @@ public:
           // TODO: better assert?
           // ASSERT(ty != CAP and ty != WALL);
           _replace_stone_at_top(NO_STONE, *sq);
-          _stack[*sq].push(stone_color(top));
+          _push(sq, stone_color(top));
         }
       };
 
@@ -176,115 +236,112 @@ public:
       spread.next(held);
 
       int to_take;
-      auto held_stack = _stack[*square].take(held - 1);
+      auto held_stack = _take(square, held - 1);
 
+      // every square the stones pass over has its stack scored again
+      auto touched = square.as_board();
       while (spread.next(to_take)) {
         auto next = find_in_direction(square, direction);
         ASSERT(next != square, "dropping on same square at `{}`", square);
         auto to_drop = held - to_take;
         auto t = held_stack.take_back(to_drop);
+        touched |= next.as_board();
         move_to_stack(next);
-        _stack[*next].push(t);
-        _replace_stone_at_top(mk_stone(FLAT, _stack[*next].pop()), *next);
+        _push(next, t);
+        _replace_stone_at_top(mk_stone(FLAT, _pop(next)), *next);
 
         square = next;
         held -= to_drop;
       }
 
-      auto taken = take_stone(origin);
+      auto taken = _take_stone(origin);
       square = find_in_direction(square, direction);
+      touched |= square.as_board();
+      auto smash = _top[*square] and stone_type(_top[*square]) == WALL;
+      _smashes = _smashes << 1 | u64(smash);
+      stats::count(stats::MAKE_SMASH, smash);
       move_to_stack(square);
-      _stack[*square].push(held_stack);
-      put_stone(taken, square);
+      _push(square, held_stack);
+      _put_stone(taken, square);
+      _rescore(touched);
     }
 
     _turn = ~_turn;
     _movecount += 1;
+    _hash ^= zobrist<Size>.black_to_move;
+    if (_movecount == 2) {
+      _hash ^= zobrist<Size>.first_move;
+    }
   }
 
   auto unmake_move(Move<Size> move) -> void {
+    stats::count(stats::UNMAKE);
     auto square = move.square();
     ASSERT(square.ok());
     if (move.is_place()) {
-      auto stone = mk_stone(
-          move.stone(), _movecount == 1 or _movecount == 2 ? _turn : ~_turn);
-      auto taken = take_stone(square);
+      const auto us = _movecount == 1 or _movecount == 2 ? _turn : ~_turn;
+      auto stone = mk_stone(move.stone(), us);
+      auto taken = _take_stone(square);
       ASSERT(taken == stone, "`{}` != `{}`", taken, stone);
+      if (move.stone() == CAP) {
+        _ncaps[us] += 1;
+      } else {
+        _nstones[us] += 1;
+      }
     } else {
       auto direction = move.direction();
       auto spread = move.spread_pattern();
-      auto taken = take_stone(square + direction);
-      auto end_square = square.move_in(direction, spread.size());
-      fmt::println("{}", end_square);
-      put_stone(taken, square);
-    }
-
-    _turn = ~_turn;
-    _movecount -= 1;
-  }
-
-  template <Color C, StoneType St>
-  constexpr auto
-  generate_spread_moves(Square<Size> origin, Square<Size> square,
-                        Direction direction, int carried, Spread<Size> partial,
-                        ArrayVec<Spread<Size>, 255>& spread) const -> void {
-    auto to = find_in_direction(square, direction);
-    if (to == square) {
-      return;
-    }
 
-    auto to_stone = _top[*to];
-    if constexpr (St == CAP) {
-      if (to_stone and stone_type(to_stone) == CAP) {
-        return;
-      }
-    } else {
-      if (to_stone and stone_type(to_stone) != FLAT) {
-        return;
+      int drops[usize(Size)] = {};
+      int nsquares = 0;
+      int held = 0;
+      int to_take;
+      spread.next(held);
+      while (spread.next(to_take)) {
+        drops[nsquares++] = held - to_take;
+        held = to_take;
       }
-    }
+      drops[nsquares++] = held;
 
-    generate_spread_moves_impl<C, St>(origin, square, direction, carried,
-                                      partial, spread);
-  }
-
-  template <Color C, StoneType St>
-  constexpr auto
-  generate_spread_moves_impl(Square<Size> origin, Square<Size> square,
-                             Direction direction, int carried,
-                             Spread<Size> partial,
-                             ArrayVec<Spread<Size>, 255>& spread) const
-      -> void {
-    auto held = square == origin ? Size : carried;
-    auto max_stones_to_take = square == origin ? std::min(carried, Size)
-                                               : std::min(carried - 1, Size);
-
-    auto generate = [&] {
-      for (int to_take = 1; to_take <= max_stones_to_take; ++to_take) {
-        auto new_spread = partial;
-        new_spread.push(to_take, held);
-        generate_spread_moves<C, St>(origin, square + direction, direction,
-                                     to_take, new_spread, spread);
-        new_spread.push(0, to_take);
-        spread.push_back(new_spread);
-      }
-    };
+      auto restore_top = [&](Square<Size> sq, StoneType st) {
+        auto top = _height[*sq] ? mk_stone(st, _pop(sq)) : NO_STONE;
+        _replace_stone_at_top(top, sq);
+      };
 
-    if constexpr (St == CAP) {
-      const auto neighbour = _top[*(square + direction)];
-      if (neighbour and stone_type(neighbour) == WALL and
-          max_stones_to_take > 0) {
-        auto new_spread = partial;
-        new_spread.push(1, held);
-        spread.push_back(new_spread);
-      } else {
-        generate();
+      // lift the moving stone and everything it still carried off the last
+      // square, and put back whatever it landed on (a wall if it was smashed)
+      auto end = square.move_in(direction, nsquares);
+      auto touched = square.as_board() | end.as_board();
+      auto moved = _top[*end];
+      auto carried = _take(end, drops[nsquares - 1] - 1);
+      restore_top(end, _smashes & 1 ? WALL : FLAT);
+
+      // pick up the drops in reverse, each one goes under what we hold
+      for (int i = nsquares - 2; i >= 0; --i) {
+        auto sq = square.move_in(direction, i + 1);
+        touched |= sq.as_board();
+        _push(sq, stone_color(_top[*sq]));
+        auto dropped = _take(sq, drops[i]);
+        restore_top(sq, FLAT);
+        dropped.push(carried);
+        carried = dropped;
       }
 
-      return;
+      if (auto top = _top[*square]) {
+        _push(square, stone_color(top));
+      }
+      _push(square, carried);
+      _replace_stone_at_top(moved, square);
+      _rescore(touched);
     }
 
-    generate();
+    if (_movecount == 2) {
+      _hash ^= zobrist<Size>.first_move;
+    }
+    _smashes >>= 1;
+    _turn = ~_turn;
+    _movecount -= 1;
+    _hash ^= zobrist<Size>.black_to_move;
   }
 
   template <Color C>
@@ -301,41 +358,75 @@ public:
       }
     }
 
-    for (const auto square : iter<Size>(stones<C>())) {
-      auto stone = _top[*square];
-      ASSERT(stone != NO_STONE);
-      auto available_squares = ~stones() | stones<FLAT>();
-      auto height = _stack[*square].height() + 1;
-      for (const auto dir :
-           IterateBits(orthogonally_adjacent_squares<Size>(square))) {
-        auto spread = ArrayVec<Spread<Size>, 255>();
-        auto direction = Direction(dir);
-        if (stone_type(stone) == CAP) {
-          generate_spread_moves<C, CAP>(square, square, direction, height, {},
-                                        spread);
-        } else {
-          generate_spread_moves<C, FLAT>(square, square, direction, height, {},
-                                         spread);
+    _for_each_spread_line<C>([&](Square<Size> square, Direction direction,
+                                 int distance, int carry, bool smash) {
+      const auto& table = spread_table<Size>;
+      const auto base = u16(direction << 6 | *square);
+      auto append = [&](std::span<const u16> patterns) {
+        auto out = moves.append(patterns.size());
+        for (auto pattern : patterns) {
+          *out++ = Move<Size>(u16(pattern | base));
         }
+      };
 
-        for (auto mv : spread) {
-          moves.push_back(Move<Size>::spread(square, direction, mv));
-        }
+      auto begin = moves.size();
+      append(table.spreads[distance].get(carry));
+      if (smash) {
+        append(table.smashes[distance].get(carry));
       }
-    }
+      stats::count_spreads(*square, moves.size() - begin);
+    });
   }
 
   constexpr auto generate_moves(MoveList<Size>& moves) const -> void {
+    stats::count(stats::GENERATE);
     if (first_move()) {
       const auto empty = ~stones();
       for (auto square : iter<Size>(empty)) {
         moves.push_back(Move<Size>::place(square, FLAT));
       }
-      return;
+    } else {
+      _turn == WHITE ? generate_moves<WHITE>(moves)
+                     : generate_moves<BLACK>(moves);
+    }
+    stats::track_moves(moves.size());
+  }
+
+  /// Number of legal moves, the same as `generate_moves(...).size()` split by
+  /// kind, without building any of them.
+  template <Color C>
+  auto count_moves() const -> MoveCount {
+    auto count = MoveCount();
+    auto empty = usize((~stones() & nbitmask(Size * Size)).count());
+    if (_nstones[C] > 0) {
+      count.placements += 2 * empty;
     }
+    if constexpr (Size >= 5) {
+      if (_ncaps[C] > 0) {
+        count.placements += empty;
+      }
+    }
+
+    _for_each_spread_line<C>([&](Square<Size>, Direction, int distance,
+                                 int carry, bool smash) {
+      const auto& table = spread_table<Size>;
+      count.spreads += table.spreads[distance].count[carry];
+      if (smash) {
+        count.smashes += table.smashes[distance].count[carry];
+      }
+    });
 
-    _turn == WHITE ? generate_moves<WHITE>(moves)
-                   : generate_moves<BLACK>(moves);
+    return count;
+  }
+
+  auto count_moves() const -> MoveCount {
+    if (first_move()) {
+      auto count = MoveCount();
+      count.placements = usize((~stones() & nbitmask(Size * Size)).count());
+      return count;
+    }
+
+    return _turn == WHITE ? count_moves<WHITE>() : count_moves<BLACK>();
   }
 
   auto print() const -> void {
@@ -367,7 +458,7 @@ public:
 
     int max_height = 0;
     for (int i = 0; i < Size * Size; ++i) {
-      auto height = _stack[i].height();
+      auto height = int(_height[i]);
       max_height = height > max_height ? height : max_height;
     }
 
@@ -384,11 +475,11 @@ public:
     fmt::print("{}\n", chars.topright);
 
     for (int i = 0; i < Size * Size; ++i) {
-      if (auto height = _stack[i].height()) {
+      if (auto height = int(_height[i])) {
         fmt::print(" {} {} {}", chars.hbar, Square<Size>(i), chars.hbar);
         for (int j = height - 1; j >= 0; --j) {
-          auto b = Bitboard(*_stack[i]);
-          fmt::print(" {}", b.get(j) ? chars.onebit : chars.zerobit);
+          auto bit = _stack[i] >> j & 1;
+          fmt::print(" {}", bit ? chars.onebit : chars.zerobit);
         }
         for (int j = 0; j < max_height - height; ++j) { fmt::print("  "); }
         fmt::print(" {}", chars.hbar);
@@ -409,7 +500,9 @@ public:
     std::memset(_colors, 0, sizeof(_colors));
     std::memset(_stones, 0, sizeof(_stones));
     std::memset(_top, 0, sizeof(_top));
+    std::memset(_height, 0, sizeof(_height));
     std::memset(_stack, 0, sizeof(_stack));
+    std::memset(_under, 0, sizeof(_under));
 
     _nstones[0] = starting_stones[Size - 3];
     _nstones[1] = starting_stones[Size - 3];
@@ -419,6 +512,9 @@ public:
 
     _turn = WHITE;
     _movecount = 0;
+    _smashes = 0ULL;
+    _hash = compute_hash();
+    _score = 0;
   }
 
   auto tps(const std::string& tps) -> void {
@@ -445,23 +541,15 @@ public:
           while ((token = col[i]) and token == '1' or token == '2') {
             auto next_token = i < col.size() - 1 ? col[i + 1] : '\0';
             auto square = Square<Size>(rank, file);
-            if (token == '1') {
-              if (next_token == 'S') {
-                put_stone(W_WALL, square);
-              } else if (next_token == 'C') {
-                put_stone(W_CAP, square);
-              } else {
-                put_stone(W_FLAT, square);
-              }
-            } else if (token == '2') {
-              if (next_token == 'S') {
-                put_stone(B_WALL, square);
-              } else if (next_token == 'C') {
-                put_stone(B_CAP, square);
-              } else {
-                put_stone(B_FLAT, square);
-              }
-            }
+            auto c = token == '1' ? WHITE : BLACK;
+            auto type = next_token == 'S'   ? WALL
+                        : next_token == 'C' ? CAP
+                                            : FLAT;
+            put_stone(mk_stone(type, c), square);
+            // whatever is on the board was placed out of the reserves
+            auto& reserve = type == CAP ? _ncaps[c] : _nstones[c];
+            ASSERT(reserve > 0, "player {} has too many stones", token);
+            reserve -= 1;
             i += 1;
           }
           file += 1;
@@ -475,21 +563,288 @@ public:
     ASSERT(turn == '1' or turn == '2');
 
     _turn = Color('2' - turn);
-    _movecount = std::stoi(ss[2]) - 1;
+    _movecount = (std::stoi(ss[2]) - 1) * 2 + (_turn == BLACK);
+    _hash = compute_hash();
   }
 
   auto turn() const -> Color { return _turn; }
 
+  /// Stones and capstones `c` has left to place, the game ends once either
+  /// player runs out.
+  auto reserves(Color c) const -> int { return _nstones[c] + _ncaps[c]; }
+  auto caps_in_hand(Color c) const -> int { return _ncaps[c]; }
+
+  /// What the stones on the board are worth to white less what they are
+  /// worth to black: each top stone by its type and square, and the stones
+  /// under it. Kept equal to `compute_score()` as stones come and go, like
+  /// the hash.
+  auto score() const -> Score { return _score; }
+
+  auto compute_score() const -> Score {
+    auto score = Score(0);
+    for (int i = 0; i < Size * Size; ++i) {
+      score += eval_tables<Size>.top[_top[i]][i] + _stack_score(usize(i));
+    }
+    return score;
+  }
+
+  /// Recomputes the position key from scratch, `hash()` is kept equal to this
+  /// incrementally.
+  auto compute_hash() const -> u64 {
+    auto hash = 0ULL;
+    for (int i = 0; i < Size * Size; ++i) {
+      auto sq = Square<Size>(i);
+      hash ^= zobrist<Size>.top[i][_top[i]];
+      hash ^= _stack_key(sq, stack(sq), 0);
+    }
+    if (_turn == BLACK) {
+      hash ^= zobrist<Size>.black_to_move;
+    }
+    if (first_move()) {
+      hash ^= zobrist<Size>.first_move;
+    }
+    return hash;
+  }
+
 private:
+  /// Calls `fn(square, direction, distance, carry, smash)` for every direction
+  /// a stack of `C` can spread in, with the number of free squares before the
+  /// first wall or capstone, the most stones it can pick up, and whether its
+  /// capstone can flatten the wall behind those squares.
+  template <Color C, typename Fn>
+  auto _for_each_spread_line(Fn fn) const -> void {
+    const auto available_squares = ~stones() | stones<FLAT>();
+    const auto blockers = *~available_squares;
+    const auto walls = *stones<WALL>();
+    for (const auto square : iter<Size>(stones<C>())) {
+      auto stone = _top[*square];
+      ASSERT(stone != NO_STONE);
+      auto carry = std::min(_height[*square] + 1, Size);
+      auto is_cap = stone_type(stone) == CAP;
+      for (const auto direction : { NORTH, EAST, SOUTH, WEST }) {
+        const auto ray = ray_table<Size>.rays[*square][direction];
+        const auto hit = ray & blockers;
+        auto distance = popcnt(ray);
+        auto smash = false;
+        if (hit) {
+          const auto forward = direction == NORTH or direction == EAST;
+          const auto blocker = forward ? lsb(hit) : msb(hit);
+          distance = popcnt(forward ? ray & nbitmask(blocker)
+                                    : ray >> (blocker + 1));
+          smash = is_cap and (walls >> blocker & 1);
+        }
+        fn(square, direction, distance, carry, smash);
+      }
+    }
+  }
+
+  template <Color C>
+  auto _road_spreads(MoveList<Size>& moves) const -> void {
+    const auto ours = groups(C);
+    const auto own = *ours.squares();
+    auto has_road = [](u64 squares) {
+      auto road = RoadSquares();
+      road.squares[C] = squares;
+      return roads<Size>(road) >> C & 1;
+    };
+
+    using G = Groups<Size>;
+    const auto& table = spread_table<Size>;
+    _for_each_spread_line<C>([&](Square<Size> square, Direction direction,
+                                 int distance, int carry, bool smash) {
+      // at best every square the stones picked up reach turns ours, joining
+      // the groups next to them
+      auto reach = square.as_board();
+      auto sq = square;
+      for (int i = 0; i < std::min(distance + smash, carry); ++i) {
+        sq = sq.move_in(direction);
+        reach |= sq.as_board();
+      }
+      const auto around = G::grow(reach);
+      auto joined = reach;
+      for (auto g : ours) {
+        joined |= *g & around ? *g : 0;
+      }
+      if (not G::spans(joined)) {
+        return;
+      }
+
+      const auto base = u16(direction << 6 | *square);
+      auto check = [&](std::span<const u16> patterns) {
+        for (auto pattern : patterns) {
+          auto move = Move<Size>(u16(pattern | base));
+          if (has_road(_road_after_spread<C>(own, move))) {
+            moves.push_back(move);
+          }
+        }
+      };
+      check(table.spreads[distance].get(carry));
+      if (smash) {
+        check(table.smashes[distance].get(carry));
+      }
+    });
+  }
+
+  /// The road squares `own` of `C` once `C` spreads `move`: every square it
+  /// drops on is topped by the last stone dropped there, and the origin by
+  /// the stone left under the ones picked up.
+  template <Color C>
+  auto _road_after_spread(u64 own, Move<Size> move) const -> u64 {
+    auto square = move.square();
+    const auto direction = move.direction();
+    const auto below = _stack[*square];
+    const auto moving = _top[*square];
+    auto set = [&](Square<Size> sq, bool ours) {
+      own = ours ? own | sq.as_board() : own & ~sq.as_board();
+    };
+    auto ours = [&](int i) { return Color(u8(below >> i) & 1) == C; };
+
+    auto spread = move.spread_pattern();
+    auto carry = 0;
+    spread.next(carry);
+    set(square, _height[*square] >= carry and ours(carry - 1));
+    // the stone under the ones still held tops each drop
+    for (int held; spread.next(held);) {
+      square = square.move_in(direction);
+      set(square, ours(held - 1));
+    }
+    set(square.move_in(direction), stone_type(moving) != WALL);
+    return own;
+  }
+
+  /// Key of `stack` sitting `base` stones above the bottom of the stack on
+  /// `sq`, including the change of height it makes there.
+  auto _stack_key(Square<Size> sq, Stack stack, int base) const -> u64 {
+    const auto top = base + stack.height() - 1;
+    auto key = zobrist<Size>.height[*sq][base] ^
+               zobrist<Size>.height[*sq][top + 1];
+    for (auto i : IterateBits(u64(*stack))) {
+      key ^= zobrist<Size>.buried[*sq][top - i];
+    }
+    if constexpr (Stack::capacity > 64) {
+      for (auto i : IterateBits(u64(*stack >> 64))) {
+        key ^= zobrist<Size>.buried[*sq][top - 64 - i];
+      }
+    }
+    return key;
+  }
+
+  auto _stone_key(Square<Size> sq, int height, Color c) const -> u64 {
+    return zobrist<Size>.height[*sq][height] ^
+           zobrist<Size>.height[*sq][height + 1] ^
+           (zobrist<Size>.buried[*sq][height] & -u64(c));
+  }
+
+  auto _put_stone(Stone st, Square<Size> sq) -> void {
+    stats::count(stats::PUT_STONE);
+    auto idx = *sq;
+    if (not _top[idx]) {
+      _replace_stone_at_top(st, sq);
+      return;
+    }
+
+    auto sty = stone_type(_top[idx]);
+    ASSERT(sty == FLAT, "`{}` found at \"{}\"", sty, sq);
+    _push(sq, stone_color(_top[idx]));
+    _replace_stone_at_top(st, sq);
+  }
+
+  auto _take_stone(Square<Size> sq) -> Stone {
+    stats::count(stats::TAKE_STONE);
+    auto idx = *sq;
+    if (not _top[idx]) {
+      return NO_STONE;
+    }
+
+    auto st = _top[idx];
+    if (not _height[idx]) {
+      _replace_stone_at_top(NO_STONE, sq);
+      return st;
+    }
+
+    auto new_top_stone = mk_stone(FLAT, _pop(sq));
+    _replace_stone_at_top(new_top_stone, sq);
+    return st;
+  }
+
+  /// What the stones under the top one of square `idx` are worth to white:
+  /// those a spread picks up with it, of the top's color (hard supports) and
+  /// of the other (captives), and of the top's color further down (soft
+  /// supports). Nothing deeper than 64 stones is counted.
+  auto _stack_score(usize idx) const -> Score {
+    const auto height = int(_height[idx]);
+    if (not height) {
+      return 0;
+    }
+    const auto type = stone_type(_top[idx]);
+    const auto c = stone_color(_top[idx]);
+    const auto whites = u64(_stack[idx]);
+    const auto own = c == WHITE ? whites : ~whites;
+    const auto carried = (1ULL << std::min(height, Size - 1)) - 1;
+    const auto below = height < 64 ? (1ULL << height) - 1 : ~0ULL;
+    auto score = weights::HARD[type] * popcnt(own & carried) +
+                 weights::CAPTIVE[type] * popcnt(~own & carried) +
+                 weights::SOFT[type] * popcnt(own & below & ~carried);
+    return c == WHITE ? score : -score;
+  }
+
+  /// Brings the stack part of `_score` up to date for `squares`, the only
+  /// ones whose stacks changed.
+  auto _rescore(u64 squares) -> void {
+    for (auto i : IterateBits(squares)) {
+      auto score = Score(_stack_score(usize(i)));
+      _score += score - _under[i];
+      _under[i] = i16(score);
+    }
+  }
+
+  auto _store(Square<Size> sq, Stack stack) -> void {
+    _stack[*sq] = *stack;
+    _height[*sq] = stack.height();
+  }
+
+  auto _push(Square<Size> sq, Color c) -> void {
+    auto stack = this->stack(sq);
+    _hash ^= _stone_key(sq, stack.height(), c);
+    stack.push(c);
+    _store(sq, stack);
+  }
+
+  auto _push(Square<Size> sq, Stack other) -> void {
+    auto stack = this->stack(sq);
+    _hash ^= _stack_key(sq, other, stack.height());
+    stack.push(other);
+    _store(sq, stack);
+  }
+
+  auto _pop(Square<Size> sq) -> Color {
+    auto stack = this->stack(sq);
+    auto c = stack.pop();
+    _hash ^= _stone_key(sq, stack.height(), c);
+    _store(sq, stack);
+    return c;
+  }
+
+  auto _take(Square<Size> sq, int n) -> Stack {
+    auto stack = this->stack(sq);
+    auto taken = stack.take(n);
+    _hash ^= _stack_key(sq, taken, stack.height());
+    _store(sq, stack);
+    return taken;
+  }
+
   auto _replace_stone_at_top(Stone st, Square<Size> sq) -> void {
+    _hash ^= zobrist<Size>.top[*sq][_top[*sq]] ^ zobrist<Size>.top[*sq][st];
+    _score += eval_tables<Size>.top[st][*sq] -
+              eval_tables<Size>.top[_top[*sq]][*sq];
     if (auto tmp_st = _top[*sq]) {
       _colors[tmp_st >> 2].template pop<Size>(sq);
-      _stones[tmp_st & 3].template pop<Size>(sq);
+      _stones[(tmp_st & 3) - 1].template pop<Size>(sq);
     }
 
     if (st) {
       _colors[st >> 2] |= sq;
-      _stones[st & 3] |= sq;
+      _stones[(st & 3) - 1] |= sq;
     } else {
       _colors[0].template pop<Size>(sq);
       _colors[1].template pop<Size>(sq);
@@ -502,10 +857,11 @@ private:
   static_assert(Size >= 3 and Size <= 8);
 
   Bitboard _colors[COLOR_NB] = {};
-  Bitboard _stones[STONE_TYPE_NB] = {};
-
-  Stone _top[usize(Size * Size)] = {};
-  Stack _stack[usize(Size * Size)] = {};
+  /// Indexed by `StoneType - 1`, there is no board of empty squares.
+  Bitboard _stones[STONE_TYPE_NB - 1] = {};
+  u64 _hash = zobrist<Size>.first_move;
+  /// See `score()`.
+  Score _score = 0;
 
   u8 _nstones[COLOR_NB] = { starting_stones[Size - 3],
                             starting_stones[Size - 3] };
@@ -513,8 +869,20 @@ private:
 
   Color _turn = WHITE;
   int _movecount = 0;
+
+  /// One bit per move made, set when that move flattened a wall, so the last
+  /// 64 moves can be unmade.
+  u64 _smashes = 0ULL;
+
+  Stone _top[usize(Size * Size)] = {};
+  /// Stones under the top one on each square, see `Stack`.
+  u8 _height[usize(Size * Size)] = {};
+  typename Stack::Word _stack[usize(Size * Size)] = {};
+  /// What the stones under each top one add to `_score`, see `_stack_score`.
+  i16 _under[usize(Size * Size)] = {};
 };
 
 } // namespace eris
 
-FMT(eris::Stack, "{}", v.to_string());
+FMT(eris::BasicStack<eris::u64>, "{}", v.to_string());
+FMT(eris::BasicStack<eris::u128>, "{}", v.to_string());
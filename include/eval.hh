@@ -0,0 +1,73 @@
+#pragma once
+
+#include <optional>
+
+#include "board.hh"
+
+namespace eris {
+
+/// Bounds every score. A won game scores `WIN` less the plies it takes, far
+/// above anything `evaluate` returns.
+constexpr Score INF = 32000;
+constexpr Score WIN = 30000;
+
+/// Score of `board` for the side to move. The stones on the board are
+/// scored as they come and go, see `Board::score`. The rest is counted here:
+/// the reserves, the lead in flats as they run out, how far each group
+/// reaches across the board, the road stones in each rank and file, and the
+/// stones of the other color next to walls and capstones.
+template <int S>
+auto evaluate(const Board<S>& board) -> Score {
+  using G = Groups<S>;
+  const auto& tables = eval_tables<S>;
+  auto score = board.score();
+
+  auto flats = board.stones(FLAT, WHITE).count() -
+               board.stones(FLAT, BLACK).count();
+  auto left = std::min(board.reserves(WHITE), board.reserves(BLACK));
+  score += Score(flats) * tables.flat_lead[left];
+
+  for (auto c : { WHITE, BLACK }) {
+    auto side = weights::RESERVE[S - 3] * board.reserves(c) +
+                weights::CAP_RESERVE[S - 3] * board.caps_in_hand(c);
+    const auto groups = board.groups(c);
+    for (auto group : groups) { side += weights::EXTENT[G::extent(*group)]; }
+    const auto road = *groups.squares();
+    const auto rank = nbitmask(S);
+    for (int i = 0; i < S; ++i) {
+      side += tables.line[popcnt(road >> (i * S) & rank)];
+      side += tables.line[popcnt(road & G::LEFT << i)];
+    }
+    const auto theirs = *board.road_squares(~c);
+    side += weights::WALL_BLOCK[S - 3] *
+            popcnt(G::grow(*board.stones(WALL, c)) & theirs);
+    side += weights::CAP_BLOCK[S - 3] *
+            popcnt(G::grow(*board.stones(CAP, c)) & theirs);
+    score += c == WHITE ? side : -side;
+  }
+  return board.turn() == WHITE ? score : -score;
+}
+
+/// The score of a game that is over for the side to move, `ply` plies from
+/// the root, nothing if it goes on. A move that makes roads for both players
+/// wins for its maker, otherwise a full board or an empty reserve ends the
+/// game on flats.
+template <int S>
+auto game_result(const Board<S>& board, int ply) -> std::optional<Score> {
+  const auto us = board.turn();
+  if (board.road(~us)) {
+    return -(WIN - ply);
+  }
+  if (board.road(us)) {
+    return WIN - ply;
+  }
+  auto full = board.stones().count() == S * S;
+  if (full or not board.reserves(WHITE) or not board.reserves(BLACK)) {
+    auto flats = board.stones(FLAT, us).count() -
+                 board.stones(FLAT, ~us).count();
+    return flats > 0 ? WIN - ply : flats < 0 ? -(WIN - ply) : 0;
+  }
+  return {};
+}
+
+} // namespace eris
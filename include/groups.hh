@@ -0,0 +1,121 @@
+#pragma once
+
+#include "bitboard.hh"
+#include "stats.hh"
+#include "tables.hh"
+
+namespace eris {
+
+/// The road squares of one color, flats and capstones, split into their
+/// orthogonally connected groups. The board does not keep these up to date
+/// as moves are made, only evaluation and road threats need them, so they are
+/// flooded from the squares when asked for.
+template <int S>
+class Groups {
+public:
+  /// Most groups a board splits into, a checkerboard.
+  static constexpr usize max_groups = usize(S * S + 1) / 2;
+
+  static constexpr u64 BOTTOM = edge_masks<S>.bottom;
+  static constexpr u64 TOP = edge_masks<S>.top;
+  static constexpr u64 LEFT = edge_masks<S>.left;
+  static constexpr u64 RIGHT = edge_masks<S>.right;
+
+  explicit Groups(Bitboard squares) : _squares(squares) {
+    for (auto rest = *squares; rest;) {
+      auto g = flood(rest & -rest, rest);
+      _push(g);
+      rest &= ~g;
+    }
+  }
+
+  auto road() const -> bool { return _roads > 0; }
+  auto squares() const -> Bitboard { return _squares; }
+  auto size() const -> usize { return _count; }
+  auto operator[](usize i) const -> Bitboard { return _groups[i]; }
+  auto begin() const -> const Bitboard* { return _groups; }
+  auto end() const -> const Bitboard* { return _groups + _count; }
+
+  /// The group `sq` belongs to, empty if it is not one of the squares.
+  auto group(Square<S> sq) const -> Bitboard {
+    for (auto g : *this) {
+      if (g.get(sq)) {
+        return g;
+      }
+    }
+    return Bitboard();
+  }
+
+  /// `b` and every square next to it.
+  static auto grow(u64 b) -> u64 {
+    auto up = b << S;
+    auto down = b >> S;
+    auto left = (b >> 1) & ~RIGHT;
+    auto right = (b << 1) & ~LEFT;
+    return (b | up | down | left | right) & nbitmask(S * S);
+  }
+
+  /// Squares of `within` connected to `seed`.
+  static auto flood(u64 seed, u64 within) -> u64 {
+    auto reach = seed & within;
+    while (true) {
+      stats::count(stats::FLOOD_ROUND);
+      auto next = grow(reach) & within;
+      if (next == reach) {
+        return reach;
+      }
+      reach = next;
+    }
+  }
+
+  static auto spans(u64 g) -> bool {
+    return ((g & TOP) and (g & BOTTOM)) or ((g & LEFT) and (g & RIGHT));
+  }
+
+  /// Whether some group of `squares` spans the board. A road needs a square
+  /// on every rank or on every file, which settles most positions without
+  /// flooding.
+  static auto has_road(u64 squares) -> bool {
+    auto across = [&](u64 from, u64 to) {
+      return bool(flood(squares & from, squares) & to);
+    };
+    return (_ranks(squares) == RIGHT and across(TOP, BOTTOM)) or
+           (_files(squares) == nbitmask(S) and across(LEFT, RIGHT));
+  }
+
+  /// Ranks or files `g` spans, whichever is more, how close it is to a road.
+  static auto extent(u64 g) -> int {
+    return std::max(popcnt(_files(g)), popcnt(_ranks(g)));
+  }
+
+private:
+  auto _push(u64 g) -> void {
+    ASSERT(_count < max_groups);
+    _groups[_count++] = g;
+    _roads += spans(g);
+  }
+
+  /// Files `g` has a square on, its rows folded onto the first.
+  static auto _files(u64 g) -> u64 {
+    auto files = g | g >> S;
+    files |= files >> (2 * S);
+    files |= files >> (4 * S);
+    return files & nbitmask(S);
+  }
+
+  /// Ranks `g` has a square on, one bit each on the last file. A rank is
+  /// taken when adding the rest of its row to its low squares carries into
+  /// its last.
+  static auto _ranks(u64 g) -> u64 {
+    constexpr auto low = ~0ULL >> (64 - S * S) & ~RIGHT;
+    return (((g & low) + low) | g) & RIGHT;
+  }
+
+  Bitboard _squares = {};
+  Bitboard _groups[max_groups] = {};
+  u8 _count = 0;
+  /// Groups connecting two opposite edges.
+  u8 _roads = 0;
+};
+
+} // namespace eris
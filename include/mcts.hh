@@ -0,0 +1,567 @@
+#pragma once
+
+#include <cmath>
+#include <mutex>
+#include <span>
+
+#include "arena.hh"
+#include "search.hh"
+
+namespace eris {
+
+/// Tunables of the Monte Carlo tree search.
+namespace mcts {
+
+/// Weight of the prior against the value in PUCT.
+constexpr f32 C_PUCT = 1.5f;
+/// How much worse than its parent a child nobody visited is taken to be.
+constexpr f32 FPU_REDUCTION = 0.25f;
+/// Score, in hundredths of a flat, that a value of tanh(1) stands for.
+constexpr f32 VALUE_SCALE = 400.0f;
+/// Priors by kind of move, before they are normalized.
+constexpr f32 PRIOR_FLAT = 1.0f;
+constexpr f32 PRIOR_WALL = 0.35f;
+constexpr f32 PRIOR_CAP = 0.5f;
+constexpr f32 PRIOR_SPREAD = 0.4f;
+/// Factor for a placement next to a stone of the side placing it.
+constexpr f32 PRIOR_NEIGHBOUR = 1.5f;
+/// Milliseconds between two reports of a running search.
+constexpr i64 REPORT_MS = 1000;
+/// Playouts of a `go` without any limit or clock.
+constexpr u64 DEFAULT_PLAYOUTS = 100000;
+/// Megabytes of the tree, both halves.
+constexpr usize DEFAULT_MB = 256;
+/// Leaves a thread gathers before it evaluates them together.
+constexpr usize BATCH = 8;
+/// Visits, each counted as a loss, that a playout on its way down adds to
+/// every edge it takes until its leaf is backed up.
+constexpr u32 VIRTUAL_LOSS = 1;
+
+} // namespace mcts
+
+/// Monte Carlo tree search. Each playout goes down the tree by PUCT, adds a
+/// node where it leaves it and scores the leaf with the static evaluation,
+/// squashed to [-1, 1] by tanh, or with the result of a game that is over.
+/// Priors come from the kind of move and where it is played.
+///
+/// A node is one block in an arena: the number of children, then their
+/// moves, priors, visit counts, value sums and nodes, each a contiguous
+/// array. The value of an edge is from the side that made its move. A child
+/// only gets a node the second time a playout reaches it, most are never
+/// reached again. When the arena is full, leaves are scored without growing
+/// the tree.
+///
+/// Every thread plays out the same tree. Visits and values are updated with
+/// atomic adds, and a playout on its way down counts as a lost visit on
+/// each edge it takes, so the next ones go elsewhere. A thread gathers a
+/// batch of leaves before it evaluates them in one call and backs them up,
+/// the shape a vectorized evaluator takes. A child is claimed before it is
+/// expanded, other threads meanwhile score it as a leaf.
+///
+/// The tree is kept between searches. When the next position is the last
+/// root or one or two moves past it, the subtree under it is copied to the
+/// other half of the memory and the rest is dropped.
+template <int S>
+class Mcts {
+public:
+  explicit Mcts(usize mb = mcts::DEFAULT_MB, int threads = 1) {
+    resize(mb);
+    set_threads(threads);
+  }
+  DISALLOW_COPY_AND_ASSIGN(Mcts);
+
+  /// Gives the tree `mb` megabytes, dropping it.
+  auto resize(usize mb) -> void {
+    _mb = mb;
+    for (auto& arena : _arenas) { arena.resize(mb * 1024 * 1024 / 2); }
+    clear();
+  }
+
+  auto clear() -> void {
+    _arena().clear();
+    _root = 0;
+    _root_visits = 0;
+    _root_value = 0;
+  }
+
+  auto set_threads(int threads) -> void {
+    ASSERT(threads >= 1);
+    _workers.resize(usize(threads));
+    for (auto& worker : _workers) {
+      if (not worker) {
+        worker = std::make_unique<Worker>();
+      }
+    }
+  }
+
+  /// Plays out `board` until a limit is hit or `stop` is called and returns
+  /// the move played out the most. `report` is called every second and at
+  /// the end. The depth limit does not apply.
+  auto go(const Board<S>& board, SearchLimits limits,
+          const SearchReport<S>& report = {}) -> Move<S> {
+    _start = chr::steady_clock::now();
+    _limits = limits;
+    _budget = TimeBudget();
+    if (not limits.infinite) {
+      _budget = time_budget(limits.time, limits.inc, limits.movetime,
+                            moves_left(board));
+    }
+    _reuse(board);
+    _board = board;
+    if (not _root) {
+      _root = _expand(*_workers[0], _board);
+      ASSERT(_root, "the tree has no room for its root");
+    }
+    _playouts = 0;
+    _depths = 0;
+
+    auto helpers = std::vector<std::thread>();
+    for (usize i = 1; i < _workers.size(); ++i) {
+      helpers.emplace_back([&, i] { _work(*_workers[i], {}); });
+    }
+    _work(*_workers[0], report);
+    _stop = true;
+    for (auto& helper : helpers) { helper.join(); }
+    {
+      auto lock = std::scoped_lock(_stop_mtx);
+      _stop = false;
+      _searches += 1;
+    }
+    _report(report);
+    return _best();
+  }
+
+  /// Ends the running search, or the next one if it has not started yet.
+  /// Safe to call from any thread.
+  auto stop() -> void { _stop = true; }
+
+  /// Ends search number `search`, see `searches()`, if it is running or has
+  /// not started yet, and does nothing once it is over. For a caller that
+  /// cannot tell whether the search it started is still going.
+  auto stop(u64 search) -> void {
+    auto lock = std::scoped_lock(_stop_mtx);
+    if (_searches == search) {
+      _stop = true;
+    }
+  }
+
+  /// Searches finished so far, the number of the next one.
+  auto searches() const -> u64 { return _searches; }
+
+  /// Playouts of the last search.
+  auto nodes() const -> u64 { return _playouts; }
+  /// Playouts through the root, with those kept from earlier searches.
+  auto root_visits() const -> u32 { return _root_visits; }
+  auto size_mb() const -> usize { return _mb; }
+  auto threads() const -> int { return int(_workers.size()); }
+
+private:
+  /// A node's children, each array `count` long.
+  struct Children {
+    u32 count;
+    u16* moves;
+    f32* priors;
+    u32* visits;
+    f32* values;
+    u32* nodes;
+  };
+
+  struct Step {
+    u32 node;
+    u32 child;
+  };
+
+  /// A playout waiting for its leaf to be evaluated.
+  struct Leaf {
+    Board<S> board;
+    Step path[MAX_PLY];
+    int depth = 0;
+    /// For the side to move on `board`, already known when the game is over.
+    f32 value = 0;
+    bool evaluated = false;
+  };
+
+  /// What a thread keeps to itself: its board and move list, and the leaves
+  /// of the batch it is gathering.
+  struct Worker {
+    Board<S> board;
+    MoveList<S> moves;
+    Leaf leaves[mcts::BATCH];
+  };
+
+  static constexpr usize HEADER = 8;
+  /// Stands in for the node of a child while a thread expands it, never an
+  /// offset the arena hands out.
+  static constexpr u32 EXPANDING = 1;
+
+  static constexpr auto _moves_bytes(usize count) -> usize {
+    return (count * sizeof(u16) + 3) & ~usize(3);
+  }
+  static constexpr auto _node_bytes(usize count) -> usize {
+    return HEADER + _moves_bytes(count) + count * (4 + 4 + 4 + 4);
+  }
+
+  template <typename T>
+  static auto _load(T& value) -> T {
+    return std::atomic_ref<T>(value).load(std::memory_order_relaxed);
+  }
+  template <typename T>
+  static auto _add(T& value, T delta) -> void {
+    std::atomic_ref<T>(value).fetch_add(delta, std::memory_order_relaxed);
+  }
+
+  auto _arena() -> Arena& { return _arenas[_current]; }
+  auto _arena() const -> const Arena& { return _arenas[_current]; }
+
+  auto _children(u32 node) const -> Children {
+    const auto& arena = _arena();
+    auto count = *arena.template at<u32>(node);
+    auto offset = u32(node + HEADER);
+    auto next = [&](usize bytes) {
+      auto at = offset;
+      offset += u32(bytes);
+      return at;
+    };
+    return {
+      .count = count,
+      .moves = arena.template at<u16>(next(_moves_bytes(count))),
+      .priors = arena.template at<f32>(next(count * 4)),
+      .visits = arena.template at<u32>(next(count * 4)),
+      .values = arena.template at<f32>(next(count * 4)),
+      .nodes = arena.template at<u32>(next(count * 4)),
+    };
+  }
+
+  /// A node for `board` with every legal move as an unvisited child, 0 when
+  /// the arena is full.
+  auto _expand(Worker& worker, const Board<S>& board) -> u32 {
+    auto& moves = worker.moves;
+    moves.clear();
+    board.generate_moves(moves);
+    auto node = _arena().allocate(_node_bytes(moves.size()));
+    if (not node) {
+      return 0;
+    }
+    *_arena().template at<u32>(node) = u32(moves.size());
+    auto ch = _children(node);
+    auto sum = 0.0f;
+    for (usize i = 0; i < moves.size(); ++i) {
+      ch.moves[i] = *moves[i];
+      ch.priors[i] = _prior(board, moves[i]);
+      sum += ch.priors[i];
+    }
+    for (usize i = 0; i < moves.size(); ++i) { ch.priors[i] /= sum; }
+    std::fill_n(ch.visits, ch.count, 0);
+    std::fill_n(ch.values, ch.count, 0.0f);
+    std::fill_n(ch.nodes, ch.count, 0);
+    return node;
+  }
+
+  /// Flats first, then capstones, spreads and walls, a placement more so
+  /// next to a stone of the side playing it.
+  static auto _prior(const Board<S>& board, Move<S> move) -> f32 {
+    if (not move.is_place()) {
+      return mcts::PRIOR_SPREAD;
+    }
+    auto prior = move.stone() == FLAT   ? mcts::PRIOR_FLAT
+                 : move.stone() == CAP ? mcts::PRIOR_CAP
+                                       : mcts::PRIOR_WALL;
+    auto around = Groups<S>::grow(move.square().as_board());
+    if (around & *board.stones(board.turn())) {
+      prior *= mcts::PRIOR_NEIGHBOUR;
+    }
+    return prior;
+  }
+
+  /// Values of the leaves not evaluated yet, each for its side to move, a
+  /// win when it has a road to place.
+  static auto _evaluate(std::span<Leaf> leaves) -> void {
+    for (auto& leaf : leaves) {
+      if (leaf.evaluated) {
+        continue;
+      }
+      const auto& board = leaf.board;
+      leaf.value =
+          board.road_placements(board.turn()).empty()
+              ? std::tanh(f32(evaluate<S>(board)) / mcts::VALUE_SCALE)
+              : 1.0f;
+      leaf.evaluated = true;
+    }
+  }
+
+  /// The child of `node` with the highest PUCT score. `visits` and `q` are
+  /// the node's own, `q` for its side to move.
+  auto _select(u32 node, u32 visits, f32 q) const -> u32 {
+    auto ch = _children(node);
+    const auto explore = mcts::C_PUCT * std::sqrt(f32(std::max(visits, 1u)));
+    const auto fpu = q - mcts::FPU_REDUCTION;
+    auto best = u32(0);
+    auto best_score = -INFINITY;
+    for (u32 i = 0; i < ch.count; ++i) {
+      auto n = _load(ch.visits[i]);
+      auto value = n ? _load(ch.values[i]) / f32(n) : fpu;
+      auto score = value + explore * ch.priors[i] / f32(1 + n);
+      if (score > best_score) {
+        best_score = score;
+        best = i;
+      }
+    }
+    return best;
+  }
+
+  /// Plays batches of playouts until the search stops. Only the first
+  /// thread reads the clock and reports.
+  auto _work(Worker& worker, const SearchReport<S>& report) -> void {
+    worker.board = _board;
+    auto next_report = mcts::REPORT_MS;
+    while (not _stop.load(std::memory_order_relaxed)) {
+      auto batch = mcts::BATCH;
+      if (_limits.nodes and not _limits.infinite) {
+        auto done = _playouts.load(std::memory_order_relaxed);
+        if (done >= _limits.nodes) {
+          break;
+        }
+        batch = usize(std::min(u64(batch), _limits.nodes - done));
+      }
+      if (report or _budget.soft) {
+        auto elapsed = _elapsed_ms();
+        if (_budget.soft and elapsed >= _budget.soft) {
+          break;
+        }
+        if (report and elapsed >= next_report) {
+          _report(report);
+          next_report += mcts::REPORT_MS;
+        }
+      }
+
+      auto leaves = std::span(worker.leaves, batch);
+      for (auto& leaf : leaves) { _descend(worker, leaf); }
+      _evaluate(leaves);
+      for (auto& leaf : leaves) { _backup(leaf); }
+      _playouts.fetch_add(batch, std::memory_order_relaxed);
+    }
+    // the other threads finish their batches and stop
+    _stop = true;
+  }
+
+  /// Goes down from the root to a leaf, taking a virtual loss on the way,
+  /// and leaves its position in `leaf`. Grows the tree the second time a
+  /// child is reached, where there is room.
+  auto _descend(Worker& worker, Leaf& leaf) -> void {
+    auto& board = worker.board;
+    auto node = _root;
+    auto visits = _root_visits.fetch_add(1, std::memory_order_relaxed) + 1;
+    auto q = _root_value.load(std::memory_order_relaxed) / f32(visits);
+    leaf.depth = 0;
+    leaf.evaluated = false;
+    for (;;) {
+      auto i = _select(node, visits, q);
+      auto ch = _children(node);
+      _add(ch.visits[i], mcts::VIRTUAL_LOSS);
+      _add(ch.values[i], -f32(mcts::VIRTUAL_LOSS));
+      board.make_move(Move<S>(ch.moves[i]));
+      leaf.path[leaf.depth++] = { node, i };
+      if (auto result = game_result(board, 0)) {
+        leaf.value = f32(std::clamp(*result, -1, 1));
+        leaf.evaluated = true;
+        break;
+      }
+
+      auto& slot = ch.nodes[i];
+      auto child = std::atomic_ref(slot).load(std::memory_order_acquire);
+      if (not child and _load(ch.visits[i]) > mcts::VIRTUAL_LOSS and
+          leaf.depth < MAX_PLY - 1) {
+        auto claimed = u32(0);
+        if (std::atomic_ref(slot).compare_exchange_strong(
+                claimed, EXPANDING, std::memory_order_relaxed)) {
+          child = _expand(worker, board);
+          std::atomic_ref(slot).store(child, std::memory_order_release);
+        }
+      }
+      if (not child or child == EXPANDING) {
+        break;
+      }
+      node = child;
+      visits = _load(ch.visits[i]);
+      q = -_load(ch.values[i]) / f32(visits);
+    }
+
+    leaf.board = board;
+    for (auto d = leaf.depth; d > 0; --d) {
+      auto [parent, i] = leaf.path[d - 1];
+      board.unmake_move(Move<S>(_children(parent).moves[i]));
+    }
+  }
+
+  /// Adds the value of `leaf` to every edge on its path, in place of the
+  /// virtual losses taken on the way down.
+  auto _backup(const Leaf& leaf) -> void {
+    auto value = leaf.value;
+    for (auto d = leaf.depth; d > 0; --d) {
+      auto [parent, i] = leaf.path[d - 1];
+      auto ch = _children(parent);
+      value = -value;
+      _add(ch.visits[i], 1 - mcts::VIRTUAL_LOSS);
+      _add(ch.values[i], value + f32(mcts::VIRTUAL_LOSS));
+    }
+    _root_value.fetch_add(value, std::memory_order_relaxed);
+    _depths.fetch_add(u64(leaf.depth), std::memory_order_relaxed);
+  }
+
+  auto _elapsed_ms() const -> i64 {
+    auto elapsed = chr::steady_clock::now() - _start;
+    return chr::duration_cast<chr::milliseconds>(elapsed).count();
+  }
+
+  auto _report(const SearchReport<S>& report) const -> void {
+    if (not report) {
+      return;
+    }
+    auto elapsed = chr::steady_clock::now() - _start;
+    auto pv = _pv();
+    auto playouts = _playouts.load(std::memory_order_relaxed);
+    auto visits = std::max(_root_visits.load(std::memory_order_relaxed), 1u);
+    auto q = std::clamp(_root_value.load(std::memory_order_relaxed) /
+                            f32(visits),
+                        -0.999f, 0.999f);
+    report({
+        .depth = int(_depths.load(std::memory_order_relaxed) /
+                     std::max(playouts, u64(1))),
+        .score = Score(mcts::VALUE_SCALE * std::atanh(q)),
+        .nodes = playouts,
+        .time = chr::duration_cast<chr::nanoseconds>(elapsed).count(),
+        .hashfull = int(_arena().used() * 1000 / _arena().capacity()),
+        .pv = pv,
+    });
+  }
+
+  /// The most visited child of `node`, the better valued one of a tie.
+  auto _best_child(u32 node) const -> u32 {
+    auto ch = _children(node);
+    auto best = u32(0);
+    auto mean = [&](u32 i) {
+      auto n = _load(ch.visits[i]);
+      return n ? _load(ch.values[i]) / f32(n) : -INFINITY;
+    };
+    for (u32 i = 1; i < ch.count; ++i) {
+      auto n = _load(ch.visits[i]), most = _load(ch.visits[best]);
+      if (n > most or (n == most and mean(i) > mean(best))) {
+        best = i;
+      }
+    }
+    return best;
+  }
+
+  auto _best() const -> Move<S> {
+    auto ch = _children(_root);
+    return Move<S>(ch.moves[_best_child(_root)]);
+  }
+
+  /// The most visited line from the root.
+  auto _pv() const -> std::vector<Move<S>> {
+    auto line = std::vector<Move<S>>();
+    for (auto node = _root; node and line.size() < usize(MAX_PLY);) {
+      auto i = _best_child(node);
+      auto ch = _children(node);
+      if (not _load(ch.visits[i])) {
+        break;
+      }
+      line.push_back(Move<S>(ch.moves[i]));
+      node = std::atomic_ref(ch.nodes[i]).load(std::memory_order_acquire);
+      if (node == EXPANDING) {
+        break;
+      }
+    }
+    return line;
+  }
+
+  /// Keeps the subtree of `board` when it is the root or up to two moves
+  /// after it, and drops the tree otherwise.
+  auto _reuse(const Board<S>& board) -> void {
+    if (not _root) {
+      return;
+    }
+    if (_board == board) {
+      return;
+    }
+
+    // makes the node of `board` up to `plies` moves under `node` the root
+    auto board_after = _board;
+    auto find = [&](u32 node, auto& self, int plies) -> bool {
+      auto ch = _children(node);
+      for (u32 i = 0; i < ch.count; ++i) {
+        if (not ch.nodes[i]) {
+          continue;
+        }
+        auto move = Move<S>(ch.moves[i]);
+        board_after.make_move(move);
+        auto found = board_after == board;
+        if (found) {
+          _root_visits = ch.visits[i];
+          _root_value = -ch.values[i];
+          _root = ch.nodes[i];
+        } else if (plies > 1) {
+          found = self(ch.nodes[i], self, plies - 1);
+        }
+        board_after.unmake_move(move);
+        if (found) {
+          return true;
+        }
+      }
+      return false;
+    };
+    if (not find(_root, find, 2)) {
+      clear();
+      return;
+    }
+
+    auto& from = _arena();
+    _current ^= 1;
+    _arena().clear();
+    _root = _copy(from, _root);
+  }
+
+  /// Copies the subtree of `node` in `from` to the current arena, which has
+  /// room for it since it holds no more than `from`.
+  auto _copy(const Arena& from, u32 node) -> u32 {
+    const auto count = *from.template at<u32>(node);
+    const auto bytes = _node_bytes(count);
+    auto copy = _arena().allocate(bytes);
+    ASSERT(copy);
+    std::memcpy(_arena().template at<std::byte>(copy),
+                from.template at<std::byte>(node), bytes);
+    auto ch = _children(copy);
+    for (u32 i = 0; i < count; ++i) {
+      if (ch.nodes[i]) {
+        ch.nodes[i] = _copy(from, ch.nodes[i]);
+      }
+    }
+    return copy;
+  }
+
+  /// The tree lives in one of the two, the other takes the subtree that is
+  /// kept for the next search.
+  Arena _arenas[2];
+  usize _current = 0;
+  usize _mb = 0;
+  std::vector<std::unique_ptr<Worker>> _workers;
+
+  Board<S> _board;
+  u32 _root = 0;
+  std::atomic<u32> _root_visits = 0;
+  /// Sum of the values of every playout, for the side to move at the root.
+  std::atomic<f32> _root_value = 0;
+
+  SearchLimits _limits;
+  TimeBudget _budget;
+  chr::steady_clock::time_point _start;
+  std::atomic<u64> _playouts = 0;
+  /// Sum of the depths of the playouts, for their average.
+  std::atomic<u64> _depths = 0;
+  std::atomic<bool> _stop = false;
+  /// Orders `stop(search)` with the end of a search.
+  std::mutex _stop_mtx;
+  std::atomic<u64> _searches = 0;
+};
+
+} // namespace eris
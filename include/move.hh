@@ -10,17 +10,17 @@ namespace eris {
 template <int S>
 class Spread {
 public:
-  Spread() = default;
-  Spread(u8 data) : _inner(data) {}
+  constexpr Spread() = default;
+  constexpr Spread(u8 data) : _inner(data) {}
 
-  auto first() -> int {
+  constexpr auto first() -> int {
     ASSERT(_inner != 0);
     return 8 - __builtin_clz(((int)_inner) << 24);
   }
 
-  auto size() -> int { return std::popcount(_inner); }
+  constexpr auto size() -> int { return std::popcount(_inner); }
 
-  auto push(int to_take, int held) -> void {
+  constexpr auto push(int to_take, int held) -> void {
     ASSERT(held > 0);
 
     auto to_drop = held - to_take;
@@ -35,7 +35,7 @@ public:
     }
   }
 
-  auto next(int& take) -> bool {
+  constexpr auto next(int& take) -> bool {
     if (_inner == 0) {
       return false;
     } else {
@@ -46,7 +46,7 @@ public:
     }
   }
 
-  auto operator*() const -> u8 { return _inner; }
+  constexpr auto operator*() const -> u8 { return _inner; }
 
 public:
   u8 _inner = 0;
@@ -119,6 +119,10 @@ public:
 
   operator int() = delete;
 
+  /// Stands for no move at all, every real move has a stone type or a spread
+  /// pattern.
+  static constexpr auto none() -> Move { return Move(u16(0)); }
+
   static constexpr auto place(Square<S> square, StoneType st) -> Move {
     ASSERT(st != NO_STONE_TYPE);
     ASSERT(square.ok());
@@ -185,13 +189,22 @@ public:
   }
 
   auto operator*() const -> u16 { return _inner; }
+  auto operator==(const Move& other) const -> bool = default;
 
 private:
   u16 _inner;
 };
 
+/// Upper bound on the number of legal moves: three placements per square, and
+/// every stack tall enough to carry a full hand spreads at most `2^S` ways along
+/// each of its two axes.
+template <int S>
+constexpr usize max_moves =
+    3 * S * S +
+    2 * (1 << S) * 2 * (starting_stones[S - 3] + starting_caps[S - 3]) / S;
+
 template <int S>
-using MoveList = ArrayVec<Move<S>, usize(S * 2 * 4 * 4)>;
+using MoveList = ArrayVec<Move<S>, max_moves<S>>;
 
 } // namespace eris
 
@@ -1,6 +1,9 @@
 #pragma once
 
+#include <numeric>
+
 #include "board.hh"
+#include "thread_pool.hh"
 
 #define BULK_COUNTING
 
@@ -16,22 +19,20 @@ auto perft(Board<S>& board, int depth) -> usize {
     return 0;
   }
 
-  usize nodes = 0;
-  auto moves = MoveList<S>();
-  board.generate_moves(moves);
-
 #ifdef BULK_COUNTING
   if (depth == 1) {
-    return moves.size();
+    return board.count_moves().total();
   }
 #endif
 
+  usize nodes = 0;
+  auto moves = MoveList<S>();
+  board.generate_moves(moves);
+
   for (const auto move : moves) {
-    auto tmp = board;
     board.make_move(move);
     nodes += perft(board, depth - 1);
-    board = tmp;
-    // board.unmake_move(move);
+    board.unmake_move(move);
   }
   return nodes;
 }
@@ -49,13 +50,148 @@ auto perft_driver(Board<S>& board, int depth) -> usize {
   }
 
   for (const auto move : moves) {
-    auto tmp = board;
     board.make_move(move);
     auto n = perft(board, depth - 1);
     nodes += n;
     fmt::println("{}: {}", move.to_string(), n);
-    board = tmp;
-    // board.unmake_move(move);
+    board.unmake_move(move);
+  }
+
+  return nodes;
+}
+
+/// Fixed-size, always-replace table of (position key, depth) -> node count.
+/// Entries store `key ^ data` next to `data`, so a torn write from another
+/// thread just reads as a miss.
+class PerftTable {
+public:
+  explicit PerftTable(usize mb) {
+    auto n = std::bit_floor(std::max(mb * 1024 * 1024 / sizeof(Entry), 1UL));
+    _entries = std::vector<Entry>(n);
+    _mask = n - 1;
+  }
+
+  auto probe(u64 key, int depth, usize& nodes) const -> bool {
+    const auto& entry = _entries[index(key, depth)];
+    auto data = entry.data.load(std::memory_order_relaxed);
+    auto check = entry.check.load(std::memory_order_relaxed);
+    if ((check ^ data) != key or int(data & 0xff) != depth) {
+      return false;
+    }
+    nodes = data >> 8;
+    return true;
+  }
+
+  auto store(u64 key, int depth, usize nodes) -> void {
+    ASSERT(nodes < 1ULL << 56);
+    auto& entry = _entries[index(key, depth)];
+    auto data = u64(nodes) << 8 | u64(depth);
+    entry.data.store(data, std::memory_order_relaxed);
+    entry.check.store(key ^ data, std::memory_order_relaxed);
+  }
+
+private:
+  struct Entry {
+    std::atomic<u64> check = 0;
+    std::atomic<u64> data = 0;
+  };
+
+  auto index(u64 key, int depth) const -> usize {
+    constexpr u64 spread = 0x9e3779b97f4a7c15ULL;
+    return (key ^ u64(depth) * spread) & _mask;
+  }
+
+private:
+  std::vector<Entry> _entries;
+  u64 _mask = 0;
+};
+
+/// Same count as `perft(board, depth)`, with subtrees of two or more plies
+/// looked up in and stored to `table`.
+template <int S>
+auto perft(Board<S>& board, int depth, PerftTable& table) -> usize {
+  if (depth <= 1) {
+    return perft(board, depth);
+  }
+
+  usize nodes = 0;
+  if (table.probe(board.hash(), depth, nodes)) {
+    return nodes;
+  }
+
+  if (not board.road()) {
+    auto moves = MoveList<S>();
+    board.generate_moves(moves);
+    for (const auto move : moves) {
+      board.make_move(move);
+      nodes += perft(board, depth - 1, table);
+      board.unmake_move(move);
+    }
+  }
+
+  table.store(board.hash(), depth, nodes);
+  return nodes;
+}
+
+/// Counts every root move's subtree on `pool`. The work below the root is
+/// split into one task per reply, so it is balanced even when a few root moves
+/// own most of the tree.
+template <int S>
+auto perft_split(Board<S>& board, int depth, ThreadPool& pool)
+    -> std::vector<usize> {
+  ASSERT(depth >= 2);
+
+  auto moves = MoveList<S>();
+  board.generate_moves(moves);
+  auto counts = std::vector<std::atomic<usize>>(moves.size());
+
+  for (usize i = 0; i < moves.size(); ++i) {
+    board.make_move(moves[i]);
+    if (depth == 2) {
+      counts[i] = perft(board, 1);
+    } else if (not board.road()) {
+      auto replies = MoveList<S>();
+      board.generate_moves(replies);
+      for (const auto reply : replies) {
+        pool.submit([&count = counts[i], board, reply, depth]() mutable {
+          board.make_move(reply);
+          count += perft(board, depth - 2);
+        });
+      }
+    }
+    board.unmake_move(moves[i]);
+  }
+
+  pool.wait();
+  return { counts.begin(), counts.end() };
+}
+
+template <int S>
+auto perft(Board<S>& board, int depth, ThreadPool& pool) -> usize {
+  if (depth <= 2 or board.road()) {
+    return perft(board, depth);
+  }
+
+  auto counts = perft_split(board, depth, pool);
+  return std::accumulate(counts.begin(), counts.end(), 0UL);
+}
+
+template <int S>
+auto perft_driver(Board<S>& board, int depth, ThreadPool& pool) -> usize {
+  ASSERT(depth >= 1);
+
+  if (depth == 1) {
+    return perft_driver(board, depth);
+  }
+
+  auto moves = MoveList<S>();
+  board.generate_moves(moves);
+  auto counts = perft_split(board, depth, pool);
+
+  usize nodes = 0;
+  for (usize i = 0; i < moves.size(); ++i) {
+    nodes += counts[i];
+    fmt::println("{}: {}", moves[i].to_string(), counts[i]);
   }
 
   return nodes;
@@ -67,7 +203,34 @@ auto perft(int depth) -> void {
   auto [duration, nodes] =
       timeit<usize>([&] { return perft<S>(board, depth); });
   fmt::println("{}: depth {}, {:.3f} ms, {:.1f} Mnps", nodes, depth,
-               duration.millis(), f32(nodes) / duration.micros());
+               duration.millis(), f64(nodes) / duration.micros());
+}
+
+template <int S>
+auto perft(int depth, usize threads) -> void {
+  auto board = Board<S>();
+  auto pool = ThreadPool(threads);
+  auto [duration, nodes] =
+      timeit<usize>([&] { return perft<S>(board, depth, pool); });
+  fmt::println("{}: depth {}, {} threads, {:.3f} ms, {:.1f} Mnps", nodes, depth,
+               threads, duration.millis(), f64(nodes) / duration.micros());
+}
+
+/// Hashed perft with a `mb` megabyte table. With `verify`, the uncached count
+/// is computed as well and a mismatch is fatal.
+template <int S>
+auto perft(int depth, usize mb, bool verify) -> void {
+  auto board = Board<S>();
+  auto table = PerftTable(mb);
+  auto [duration, nodes] =
+      timeit<usize>([&] { return perft<S>(board, depth, table); });
+  fmt::println("{}: depth {}, {} MB hash, {:.3f} ms, {:.1f} Mnps", nodes, depth,
+               mb, duration.millis(), f64(nodes) / duration.micros());
+
+  if (verify) {
+    auto [_, expected] = timeit<usize>([&] { return perft<S>(board, depth); });
+    ASSERT(nodes == expected, "hashed perft {} != {}", nodes, expected);
+  }
 }
 
 } // namespace eris
@@ -0,0 +1,206 @@
+#pragma once
+
+#include <concepts>
+#include <span>
+
+#ifdef __AVX2__
+#  include <immintrin.h>
+#endif
+
+#include "stats.hh"
+#include "tables.hh"
+
+namespace eris {
+
+/// Four bitboards flooded side by side, one plain `u64` each.
+struct ScalarLanes {
+  u64 lanes[4] = {};
+
+  static auto from(u64 a, u64 b, u64 c, u64 d) -> ScalarLanes {
+    return { { a, b, c, d } };
+  }
+
+  template <typename Fn>
+  static auto map(ScalarLanes a, ScalarLanes b, Fn fn) -> ScalarLanes {
+    auto r = ScalarLanes();
+    for (usize i = 0; i < 4; ++i) { r.lanes[i] = fn(a.lanes[i], b.lanes[i]); }
+    return r;
+  }
+
+  friend auto operator&(ScalarLanes a, ScalarLanes b) -> ScalarLanes {
+    return map(a, b, [](u64 x, u64 y) { return x & y; });
+  }
+
+  friend auto operator|(ScalarLanes a, ScalarLanes b) -> ScalarLanes {
+    return map(a, b, [](u64 x, u64 y) { return x | y; });
+  }
+
+  template <int N>
+  auto shl() const -> ScalarLanes {
+    return map(*this, {}, [](u64 x, u64) { return x << N; });
+  }
+
+  template <int N>
+  auto shr() const -> ScalarLanes {
+    return map(*this, {}, [](u64 x, u64) { return x >> N; });
+  }
+
+  auto operator==(const ScalarLanes&) const -> bool = default;
+
+  /// Bit `i` set when lane `i` is not empty.
+  auto nonzero() const -> u8 {
+    auto m = 0;
+    for (usize i = 0; i < 4; ++i) { m |= (lanes[i] != 0) << i; }
+    return u8(m);
+  }
+};
+
+#ifdef __AVX2__
+/// Four bitboards flooded side by side in one AVX2 register.
+struct Avx2Lanes {
+  __m256i lanes;
+
+  static auto from(u64 a, u64 b, u64 c, u64 d) -> Avx2Lanes {
+    return { _mm256_setr_epi64x(i64(a), i64(b), i64(c), i64(d)) };
+  }
+
+  friend auto operator&(Avx2Lanes a, Avx2Lanes b) -> Avx2Lanes {
+    return { _mm256_and_si256(a.lanes, b.lanes) };
+  }
+
+  friend auto operator|(Avx2Lanes a, Avx2Lanes b) -> Avx2Lanes {
+    return { _mm256_or_si256(a.lanes, b.lanes) };
+  }
+
+  template <int N>
+  auto shl() const -> Avx2Lanes {
+    return { _mm256_slli_epi64(lanes, N) };
+  }
+
+  template <int N>
+  auto shr() const -> Avx2Lanes {
+    return { _mm256_srli_epi64(lanes, N) };
+  }
+
+  auto operator==(const Avx2Lanes& other) const -> bool {
+    auto diff = _mm256_xor_si256(lanes, other.lanes);
+    return _mm256_testz_si256(diff, diff);
+  }
+
+  auto nonzero() const -> u8 {
+    auto zero = _mm256_cmpeq_epi64(lanes, _mm256_setzero_si256());
+    return u8(~_mm256_movemask_pd(_mm256_castsi256_pd(zero)) & 0xf);
+  }
+};
+
+using RoadLanes = Avx2Lanes;
+#else
+using RoadLanes = ScalarLanes;
+#endif
+
+/// Flats and capstones of both colors, what `roads` looks at.
+struct RoadSquares {
+  Bitboard squares[COLOR_NB] = {};
+};
+
+namespace detail {
+
+/// `roads` for the `K` boards at `boards`, flooded in step so that the
+/// boards' fills, each a long chain of dependent shifts, overlap.
+template <int S, typename Lanes, usize K>
+auto roads(const RoadSquares* boards, u8* out) -> void {
+  constexpr auto BOTTOM = edge_masks<S>.bottom, TOP = edge_masks<S>.top;
+  constexpr auto LEFT = edge_masks<S>.left, RIGHT = edge_masks<S>.right;
+
+  // occluded fill along one direction: the squares of `prop` in line behind
+  // `gen`, up to seven steps away. The masks of runs of 2 and 4 squares only
+  // depend on the board, so they are built once.
+  struct Fill {
+    Lanes p1, p2, p4;
+  };
+  auto forward = []<int N>(Lanes prop) -> Fill {
+    auto p2 = prop & prop.template shl<N>();
+    return { prop, p2, p2 & p2.template shl<2 * N>() };
+  };
+  auto backward = []<int N>(Lanes prop) -> Fill {
+    auto p2 = prop & prop.template shr<N>();
+    return { prop, p2, p2 & p2.template shr<2 * N>() };
+  };
+  auto shl = []<int N>(Lanes gen, const Fill& f) {
+    gen = gen | (f.p1 & gen.template shl<N>());
+    gen = gen | (f.p2 & gen.template shl<2 * N>());
+    return gen | (f.p4 & gen.template shl<4 * N>());
+  };
+  auto shr = []<int N>(Lanes gen, const Fill& f) {
+    gen = gen | (f.p1 & gen.template shr<N>());
+    gen = gen | (f.p2 & gen.template shr<2 * N>());
+    return gen | (f.p4 & gen.template shr<4 * N>());
+  };
+
+  Fill up[K], down[K], right[K], left[K];
+  Lanes reach[K];
+  for (usize k = 0; k < K; ++k) {
+    const auto w = *boards[k].squares[WHITE], b = *boards[k].squares[BLACK];
+    const auto grid = Lanes::from(w, w, b, b);
+    up[k] = forward.template operator()<S>(grid);
+    down[k] = backward.template operator()<S>(grid);
+    right[k] = forward.template operator()<1>(
+        grid & Lanes::from(~LEFT, ~LEFT, ~LEFT, ~LEFT));
+    left[k] = backward.template operator()<1>(
+        grid & Lanes::from(~RIGHT, ~RIGHT, ~RIGHT, ~RIGHT));
+    reach[k] = grid & Lanes::from(TOP, LEFT, TOP, LEFT);
+  }
+
+  // another round of a board that has stopped growing leaves it as it is
+  for (auto done = false; not done;) {
+    done = true;
+    stats::count(stats::FLOOD_ROUND);
+    for (usize k = 0; k < K; ++k) {
+      auto next = shl.template operator()<S>(reach[k], up[k]);
+      next = shr.template operator()<S>(next, down[k]);
+      next = shl.template operator()<1>(next, right[k]);
+      next = shr.template operator()<1>(next, left[k]);
+      done = done and next == reach[k];
+      reach[k] = next;
+    }
+  }
+
+  const auto goal = Lanes::from(BOTTOM, RIGHT, BOTTOM, RIGHT);
+  for (usize k = 0; k < K; ++k) {
+    const auto hit = (reach[k] & goal).nonzero();
+    auto white = (hit & 0b0011) ? 1 << WHITE : 0;
+    auto black = (hit & 0b1100) ? 1 << BLACK : 0;
+    out[k] = u8(white | black);
+  }
+}
+
+} // namespace detail
+
+/// Colors with a road, bit `c` is set when color `c` has one.
+///
+/// Floods top to bottom and left to right for both colors at once, one lane
+/// each. Every round fills whole lines in each direction with a Kogge-Stone
+/// fill instead of growing a step at a time, so a road takes about as many
+/// rounds as it has turns.
+template <int S, typename Lanes = RoadLanes>
+auto roads(RoadSquares board) -> u8 {
+  auto road = u8();
+  detail::roads<S, Lanes, 1>(&board, &road);
+  return road;
+}
+
+/// `roads` for every board of `boards` into `out`, a few boards at a time
+/// when the lanes are a vector register. Plain `u64` lanes already run side by
+/// side, and more of them would only spill.
+template <int S, typename Lanes = RoadLanes>
+auto roads(std::span<const RoadSquares> boards, std::span<u8> out) -> void {
+  constexpr usize K = std::same_as<Lanes, ScalarLanes> ? 1 : 4;
+  ASSERT(out.size() >= boards.size());
+  auto i = usize(0);
+  for (; i + K <= boards.size(); i += K) {
+    detail::roads<S, Lanes, K>(&boards[i], &out[i]);
+  }
+  for (; i < boards.size(); ++i) { out[i] = roads<S, Lanes>(boards[i]); }
+}
+
+} // namespace eris
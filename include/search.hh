@@ -0,0 +1,573 @@
+#pragma once
+
+#include <atomic>
+#include <functional>
+#include <optional>
+#include <random>
+#include <thread>
+
+#include "eval.hh"
+#include "timeman.hh"
+#include "tinue.hh"
+#include "tt.hh"
+
+namespace eris {
+
+/// Deepest a search goes. `Board` can unmake the last 64 moves.
+constexpr int MAX_PLY = 64;
+
+/// A decided game, whichever side won.
+constexpr auto is_win(Score score) -> bool {
+  return std::abs(score) > WIN - MAX_PLY;
+}
+
+/// Moves to the end of the game a winning score stands for, negative when the
+/// side to move loses.
+constexpr auto moves_to_win(Score score) -> int {
+  auto plies = WIN - std::abs(score);
+  return score > 0 ? (plies + 1) / 2 : -(plies / 2);
+}
+
+/// Wins count plies from the root, the table keeps them from the node so an
+/// entry holds wherever the position comes up again.
+constexpr auto score_to_tt(Score score, int ply) -> i16 {
+  if (is_win(score)) {
+    score += score > 0 ? ply : -ply;
+  }
+  return i16(score);
+}
+
+constexpr auto score_from_tt(i16 score, int ply) -> Score {
+  if (is_win(score)) {
+    return score > 0 ? score - ply : score + ply;
+  }
+  return score;
+}
+
+struct SearchLimits {
+  /// Deepest iteration, 0 for no limit.
+  int depth = 0;
+  /// Nodes after which the search gives up, 0 for no limit.
+  u64 nodes = 0;
+  /// Milliseconds the side to move has on its clock and gains every move,
+  /// no clock when 0.
+  i64 time = 0;
+  i64 inc = 0;
+  /// Milliseconds to spend on this move.
+  i64 movetime = 0;
+  /// Ignore every limit above and search until stopped.
+  bool infinite = false;
+};
+
+/// Moves the side to move is likely to have left. The game ends when either
+/// side runs out of pieces or the board fills up, and about every third move
+/// is a spread rather than a placement.
+template <int S>
+auto moves_left(const Board<S>& board) -> int {
+  auto empty = S * S - board.stones().count();
+  auto pieces = std::min({ board.reserves(WHITE), board.reserves(BLACK),
+                           (empty + 1) / 2 });
+  return std::clamp(pieces * 3 / 2, 3, 50);
+}
+
+/// Nodes the tinuë solver may expand before a search, and the share of the
+/// soft time limit it may take.
+constexpr u64 TINUE_NODES = 4096;
+constexpr i64 TINUE_TIME_SHARE = 16;
+
+/// What the search found after each iteration it finished.
+template <int S>
+struct SearchInfo {
+  int depth = 0;
+  Score score = 0;
+  u64 nodes = 0;
+  duration time = 0;
+  /// Permille of the transposition table in use.
+  int hashfull = 0;
+  std::span<const Move<S>> pv;
+};
+template <int S>
+using SearchReport = std::function<void(const SearchInfo<S>&)>;
+
+/// What the threads of one search share besides the transposition table.
+struct SearchShared {
+  SearchLimits limits;
+  TimeBudget budget;
+  chr::steady_clock::time_point start;
+  std::atomic<bool> stop = false;
+  /// Nodes of every thread, each adds its own in batches.
+  std::atomic<u64> nodes = 0;
+
+  auto elapsed_ms() const -> i64 {
+    auto elapsed = chr::steady_clock::now() - start;
+    return chr::duration_cast<chr::milliseconds>(elapsed).count();
+  }
+};
+
+namespace detail {
+
+/// Depths a helper thread skips, so the threads of a Lazy SMP search spread
+/// over neighbouring depths instead of all searching the same one.
+constexpr int skip_size[] = { 1, 1, 2, 2, 2, 2, 3, 3, 3, 3,
+                              3, 3, 4, 4, 4, 4, 4, 4, 4, 4 };
+constexpr int skip_phase[] = { 0, 1, 0, 1, 2, 3, 0, 1, 2, 3,
+                               4, 5, 0, 1, 2, 3, 4, 5, 6, 7 };
+
+/// One thread of a search: principal variation search with iterative
+/// deepening on its own copy of the board. Every iteration starts from the
+/// last one's best line, then tries the move the table holds, the moves that
+/// refuted siblings (killers) and moves that cut often anywhere (history).
+template <int S>
+class SearchThread {
+public:
+  SearchThread(int id, TranspositionTable& tt, SearchShared& shared)
+      : _id(id), _tt(tt), _shared(shared) {}
+
+  /// Searches `board` one ply deeper at a time until a limit is hit or
+  /// another thread stops the search. Only the main thread, id 0, calls
+  /// `report` after every iteration that finished.
+  auto go(const Board<S>& board, const SearchReport<S>& report) -> void {
+    _board = board;
+    _pending = 0;
+    _stopped = false;
+    _prev_length = 0;
+    _completed = 0;
+    _stable = 0;
+    _score = 0;
+    for (auto& killers : _killers) { rng::fill(killers, Move<S>::none()); }
+    rng::fill(_history, 0);
+    if (_id > 0) {
+      // a little noise breaks the ties in move ordering differently
+      auto noise = std::mt19937(u32(_id));
+      for (auto& h : _history) { h = i32(noise() % 16); }
+    }
+
+    auto moves = MoveList<S>();
+    _board.generate_moves(moves);
+    ASSERT(moves.size(), "no legal moves");
+    _best = moves[0];
+
+    auto max_depth = MAX_PLY - 1;
+    if (_shared.limits.depth and not _shared.limits.infinite) {
+      max_depth = std::min(_shared.limits.depth, max_depth);
+    }
+
+    for (int depth = 1; depth <= max_depth; ++depth) {
+      if (_id > 0) {
+        auto i = usize(_id - 1) % std::size(skip_size);
+        if ((depth + _board.movecount() + skip_phase[i]) / skip_size[i] % 2) {
+          continue;
+        }
+      }
+
+      _follow_pv = true;
+      auto score = _search(-INF, INF, depth, 0);
+      // an unfinished iteration only counts when there is nothing better
+      if (_stopped and _completed) {
+        break;
+      }
+      if (_pv_length[0]) {
+        _stable = _completed and _pv[0][0] == _best ? _stable + 1 : 0;
+        _best = _pv[0][0];
+        _score = score;
+        _completed = depth;
+        _prev_length = _pv_length[0];
+        rng::copy_n(_pv[0], _prev_length, _prev_pv);
+      }
+
+      if (report and not _stopped) {
+        auto elapsed = chr::steady_clock::now() - _shared.start;
+        report({
+            .depth = depth,
+            .score = score,
+            .nodes = _shared.nodes.load(std::memory_order_relaxed) + _pending,
+            .time = chr::duration_cast<chr::nanoseconds>(elapsed).count(),
+            .hashfull = _tt.hashfull(),
+            .pv = pv(),
+        });
+      }
+      if (_stopped or is_win(score)) {
+        break;
+      }
+      // the next iteration takes a lot longer than this one, only start it
+      // while there is time left for it
+      const auto soft = _shared.budget.soft;
+      if (_id == 0 and soft and
+          f64(_shared.elapsed_ms()) > f64(soft) * stability_scale(_stable)) {
+        break;
+      }
+    }
+    _shared.nodes.fetch_add(_pending, std::memory_order_relaxed);
+    _pending = 0;
+  }
+
+  /// Deepest iteration that finished, and its score and line.
+  auto completed() const -> int { return _completed; }
+  auto score() const -> Score { return _score; }
+  auto best() const -> Move<S> { return _best; }
+  auto pv() const -> std::span<const Move<S>> {
+    return { _prev_pv, usize(_prev_length) };
+  }
+
+private:
+  /// Nodes are added to the shared count this many at a time.
+  static constexpr u64 NODE_BATCH = 1024;
+
+  /// Counts a node. The clock is only read once a batch of them is done,
+  /// under a millisecond apart.
+  auto _visit() -> void {
+    if (++_pending == NODE_BATCH) {
+      _shared.nodes.fetch_add(_pending, std::memory_order_relaxed);
+      _pending = 0;
+      const auto hard = _shared.budget.hard;
+      if (hard and _shared.elapsed_ms() >= hard) {
+        _shared.stop = true;
+      }
+    }
+  }
+
+  /// Whether to give up, because another thread stopped the search or the
+  /// node limit was reached.
+  auto _should_stop() -> bool {
+    if (_shared.stop.load(std::memory_order_relaxed)) {
+      return true;
+    }
+    const auto limit = _shared.limits.nodes;
+    if (limit and not _shared.limits.infinite and
+        _shared.nodes.load(std::memory_order_relaxed) + _pending >= limit) {
+      _shared.stop = true;
+      return true;
+    }
+    return false;
+  }
+
+  auto _search(Score alpha, Score beta, int depth, int ply) -> Score {
+    auto& board = _board;
+    _pv_length[ply] = ply;
+    if (ply > 0) {
+      if (auto result = game_result(board, ply)) {
+        _visit();
+        return *result;
+      }
+      // a road one placement away wins next move, at any depth
+      if (not board.road_placements(board.turn()).empty()) {
+        _visit();
+        return WIN - ply - 1;
+      }
+      if (depth <= 0 or ply == MAX_PLY - 1) {
+        _visit();
+        return evaluate<S>(board);
+      }
+      if (_should_stop()) {
+        _stopped = true;
+        return 0;
+      }
+    }
+    _visit();
+
+    const auto key = board.hash();
+    auto tt_move = Move<S>::none();
+    if (auto entry = _tt.probe(key)) {
+      tt_move = Move<S>(entry->move);
+      auto score = score_from_tt(entry->score, ply);
+      auto pv_node = beta - alpha > 1;
+      if (ply > 0 and not pv_node and entry->depth >= depth and
+          (entry->bound == BOUND_EXACT or
+           (entry->bound == BOUND_LOWER and score >= beta) or
+           (entry->bound == BOUND_UPPER and score <= alpha))) {
+        return score;
+      }
+    }
+
+    auto moves = MoveList<S>();
+    board.generate_moves(moves);
+    i32 scores[max_moves<S>];
+    _order(moves, scores, tt_move, ply);
+
+    const auto alpha_orig = alpha;
+    auto best = -INF;
+    auto best_move = Move<S>::none();
+    for (usize i = 0; i < moves.size(); ++i) {
+      auto move = _pick(moves, scores, i);
+      board.make_move(move);
+      auto score = Score();
+      if (i == 0) {
+        score = -_search(-beta, -alpha, depth - 1, ply + 1);
+      } else {
+        score = -_search(-alpha - 1, -alpha, depth - 1, ply + 1);
+        if (score > alpha and score < beta) {
+          score = -_search(-beta, -alpha, depth - 1, ply + 1);
+        }
+      }
+      board.unmake_move(move);
+      _follow_pv = false;
+      if (_stopped) {
+        return 0;
+      }
+
+      best = std::max(best, score);
+      if (score > alpha) {
+        alpha = score;
+        best_move = move;
+        _pv[ply][ply] = move;
+        for (int j = ply + 1; j < _pv_length[ply + 1]; ++j) {
+          _pv[ply][j] = _pv[ply + 1][j];
+        }
+        _pv_length[ply] = _pv_length[ply + 1];
+        if (alpha >= beta) {
+          _cutoff(board.turn(), move, depth, ply);
+          break;
+        }
+      }
+    }
+
+    auto bound = best >= beta        ? BOUND_LOWER
+                 : best > alpha_orig ? BOUND_EXACT
+                                     : BOUND_UPPER;
+    _tt.store(key, {
+                       .move = *best_move,
+                       .score = score_to_tt(best, ply),
+                       .depth = u8(depth),
+                       .bound = bound,
+                   });
+    return best;
+  }
+
+  /// Scores every move for `_pick`, the previous iteration's move first, then
+  /// the table's, then the killers, then by history.
+  auto _order(const MoveList<S>& moves, i32* scores, Move<S> tt_move, int ply)
+      -> void {
+    auto pv_move = Move<S>::none();
+    if (_follow_pv and ply < _prev_length) {
+      pv_move = _prev_pv[ply];
+    }
+    auto found_pv = false;
+    const auto* history = &_history[usize(_board.turn()) << 16];
+    for (usize i = 0; i < moves.size(); ++i) {
+      auto move = moves[i];
+      if (move == pv_move) {
+        scores[i] = 1 << 30;
+        found_pv = true;
+      } else if (move == tt_move) {
+        scores[i] = (1 << 30) - 1;
+      } else if (move == _killers[ply][0]) {
+        scores[i] = 1 << 29;
+      } else if (move == _killers[ply][1]) {
+        scores[i] = 1 << 28;
+      } else {
+        scores[i] = history[*move];
+      }
+    }
+    _follow_pv = found_pv;
+  }
+
+  /// Swaps the best scored of the moves from `i` on into `i`.
+  static auto _pick(MoveList<S>& moves, i32* scores, usize i) -> Move<S> {
+    auto best = i;
+    for (auto j = i + 1; j < moves.size(); ++j) {
+      if (scores[j] > scores[best]) {
+        best = j;
+      }
+    }
+    std::swap(moves[i], moves[best]);
+    std::swap(scores[i], scores[best]);
+    return moves[i];
+  }
+
+  auto _cutoff(Color us, Move<S> move, int depth, int ply) -> void {
+    if (move != _killers[ply][0]) {
+      _killers[ply][1] = _killers[ply][0];
+      _killers[ply][0] = move;
+    }
+    auto& history = _history[usize(us) << 16 | *move];
+    history += depth * depth;
+    // stay below the killers
+    if (history >= 1 << 27) {
+      for (auto& h : _history) { h /= 2; }
+    }
+  }
+
+  const int _id;
+  TranspositionTable& _tt;
+  SearchShared& _shared;
+  Board<S> _board;
+  /// Nodes not yet added to `_shared.nodes`.
+  u64 _pending = 0;
+  bool _stopped = false;
+
+  int _completed = 0;
+  Score _score = 0;
+  /// Iterations in a row that ended on the same best move.
+  int _stable = 0;
+  Move<S> _best = Move<S>::none();
+
+  /// `_pv[ply]` is the best line found from `ply`, up to `_pv_length[ply]`.
+  Move<S> _pv[MAX_PLY][MAX_PLY];
+  int _pv_length[MAX_PLY] = {};
+  /// The last finished iteration's line, searched first by the next one.
+  Move<S> _prev_pv[MAX_PLY];
+  int _prev_length = 0;
+  /// Whether the current node is on `_prev_pv`.
+  bool _follow_pv = false;
+
+  Move<S> _killers[MAX_PLY][2];
+  /// Indexed by color and move.
+  std::vector<i32> _history = std::vector<i32>(COLOR_NB << 16);
+};
+
+} // namespace detail
+
+/// Lazy SMP: every thread searches the same root on its own board, sharing
+/// only the transposition table, and they find different parts of the tree
+/// through what the others stored. Helpers skip some depths and order moves
+/// a little differently to keep them apart. When the main thread finishes,
+/// the threads vote for a move by how deep they got and how they scored it.
+template <int S>
+class Search {
+public:
+  using Report = SearchReport<S>;
+
+  /// With a `tinue` table, every search first looks for a tinuë of the side
+  /// to move, and plays it without searching when there is one.
+  explicit Search(TranspositionTable& tt, int threads = 1,
+                  TinueTable* tinue = nullptr)
+      : _tt(tt) {
+    ASSERT(threads >= 1);
+    for (int id = 0; id < threads; ++id) {
+      _threads.push_back(
+          std::make_unique<detail::SearchThread<S>>(id, tt, _shared));
+    }
+    if (tinue) {
+      _solver = std::make_unique<TinueSolver<S>>(*tinue);
+    }
+  }
+
+  /// Searches `board` until a limit is hit and returns the move the threads
+  /// agree on. `report` is called after every iteration the main thread
+  /// finished.
+  auto go(const Board<S>& board, SearchLimits limits, const Report& report = {})
+      -> Move<S> {
+    _shared.limits = limits;
+    _shared.budget = TimeBudget();
+    if (not limits.infinite) {
+      _shared.budget = time_budget(limits.time, limits.inc, limits.movetime,
+                                   moves_left(board));
+    }
+    _shared.start = chr::steady_clock::now();
+    _shared.nodes = 0;
+    if (auto win = _prove(board, report)) {
+      _shared.stop = false;
+      return *win;
+    }
+    _tt.new_search();
+
+    auto helpers = std::vector<std::thread>();
+    for (usize i = 1; i < _threads.size(); ++i) {
+      helpers.emplace_back([&, i] { _threads[i]->go(board, {}); });
+    }
+    _threads[0]->go(board, report);
+    _shared.stop = true;
+    for (auto& helper : helpers) { helper.join(); }
+    _shared.stop = false;
+    return _vote().best();
+  }
+
+  /// Ends the running search as soon as it has a move, or the next one if
+  /// it has not started yet. Safe to call from any thread.
+  auto stop() -> void {
+    _shared.stop = true;
+    if (_solver) {
+      _solver->stop();
+    }
+  }
+
+  auto nodes() const -> u64 {
+    return _shared.nodes.load(std::memory_order_relaxed);
+  }
+
+private:
+  /// The first move of a tinuë the solver finds within its share of the
+  /// limits, reported as a win that far away.
+  auto _prove(const Board<S>& board, const Report& report)
+      -> std::optional<Move<S>> {
+    if (not _solver or _shared.stop) {
+      return {};
+    }
+    auto limits = TinueLimits{ .nodes = TINUE_NODES };
+    const auto& search = _shared.limits;
+    if (search.nodes and not search.infinite) {
+      limits.nodes = std::min(limits.nodes, search.nodes / 2 + 1);
+    }
+    if (_shared.budget.soft) {
+      limits.movetime = std::max(_shared.budget.soft / TINUE_TIME_SHARE,
+                                 i64(1));
+    }
+    auto result = _solver->solve(board, limits);
+    _shared.nodes += _solver->nodes();
+    auto pv = _solver->pv();
+    if (result != TINUE_PROVEN or pv.empty()) {
+      return {};
+    }
+
+    if (report) {
+      auto elapsed = chr::steady_clock::now() - _shared.start;
+      report({
+          .depth = int(pv.size()),
+          .score = WIN - int(pv.size()),
+          .nodes = nodes(),
+          .time = chr::duration_cast<chr::nanoseconds>(elapsed).count(),
+          .hashfull = _tt.hashfull(),
+          .pv = pv,
+      });
+    }
+    return pv[0];
+  }
+
+  /// A proven win stands, the shortest one first. Otherwise every thread
+  /// votes for its move by its depth and how much better than the worst
+  /// thread it scored.
+  auto _vote() const -> const detail::SearchThread<S>& {
+    auto min_score = INF;
+    for (const auto& t : _threads) {
+      if (t->completed()) {
+        min_score = std::min(min_score, t->score());
+      }
+    }
+
+    auto votes = std::vector<std::pair<Move<S>, i64>>();
+    auto votes_for = [&](Move<S> move) -> i64& {
+      auto it = rng::find(votes, move, [](const auto& v) { return v.first; });
+      if (it != votes.end()) {
+        return it->second;
+      }
+      return votes.emplace_back(move, 0).second;
+    };
+    for (const auto& t : _threads) {
+      votes_for(t->best()) += i64(t->score() - min_score + 14) * t->completed();
+    }
+
+    auto won = [](Score score) { return score > WIN - MAX_PLY; };
+    const auto* chosen = _threads[0].get();
+    for (const auto& t : _threads) {
+      if (not t->completed()) {
+        continue;
+      }
+      if (won(t->score())) {
+        if (t->score() > chosen->score()) {
+          chosen = t.get();
+        }
+      } else if (not won(chosen->score()) and
+                 votes_for(t->best()) > votes_for(chosen->best())) {
+        chosen = t.get();
+      }
+    }
+    return *chosen;
+  }
+
+  TranspositionTable& _tt;
+  SearchShared _shared;
+  std::vector<std::unique_ptr<detail::SearchThread<S>>> _threads;
+  std::unique_ptr<TinueSolver<S>> _solver;
+};
+
+} // namespace eris
@@ -46,7 +46,7 @@ public:
            : direction == SOUTH ? rank() > 0
            : direction == EAST  ? file() < Size - 1
                                 : file() > 0);
-    return Square<Size>(_idx + u8(offset[direction] * n));
+    return Square<Size>(_idx + offset[direction] * n);
   }
 
   constexpr auto operator+=(Direction direction) -> void {
@@ -4,26 +4,84 @@
 
 namespace eris {
 
-class Stack {
+/// Stones buried under the top stone of a square, bit 0 is the one right
+/// below it. Every operation is a fixed number of shifts on `Bits`, which has
+/// to be wide enough for all the stones of the board, see `StackOf`.
+template <typename Bits>
+class BasicStack {
 public:
-  constexpr Stack() noexcept = default;
-  constexpr Stack(u64 stack, int height);
+  using Word = Bits;
+  static constexpr int capacity = int(sizeof(Bits) * 8);
+
+  constexpr BasicStack() noexcept = default;
+  constexpr BasicStack(Bits stack, int height)
+      : _stack(stack), _height(u8(height)) {
+    ASSERT(height >= 0 and height < capacity);
+  }
 
   auto top() const -> Color { return Color(_stack & 1); }
   auto height() const -> u8 { return _height; }
-  auto operator*() const -> u64 { return _stack; }
-
-  auto push(Color c) -> void;
-  auto push(Stack other) -> void;
-  auto take(int n) -> Stack;
-  auto take_back(int n) -> Stack;
-  auto pop(int n = 1) -> Color;
-  auto pop_back(int n = 1) -> Color;
+  auto operator*() const -> Bits { return _stack; }
+  auto operator==(const BasicStack& other) const -> bool = default;
+
+  auto push(Color c) -> void {
+    ASSERT(_height + 1 < capacity);
+    _stack <<= 1;
+    _stack |= c;
+    _height += 1;
+  }
+
+  auto push(BasicStack other) -> void {
+    ASSERT(_height + other.height() < capacity);
+    _stack <<= other.height();
+    _stack |= *other;
+    _height += other.height();
+  }
+
+  auto take(int n) -> BasicStack {
+    auto taken = BasicStack(_stack & mask(n), n);
+    pop(n);
+    return taken;
+  }
+
+  auto take_back(int n) -> BasicStack {
+    auto taken = BasicStack(_stack >> (_height - n), n);
+    pop_back(n);
+    return taken;
+  }
+
+  auto pop(int n = 1) -> Color {
+    auto c = top();
+    _stack >>= n;
+    _height -= u8(n);
+    return c;
+  }
+
+  auto pop_back(int n = 1) -> Color {
+    auto c = top();
+    _stack &= mask(_height - n);
+    _height -= u8(n);
+    return c;
+  }
+
   auto to_string() const -> std::string;
 
 private:
-  u64 _stack = 0ULL;
+  static auto mask(int n) -> Bits {
+    ASSERT(n >= 0 and n < capacity);
+    return (Bits(1) << n) - 1;
+  }
+
+  Bits _stack = 0;
   u8 _height = 0;
 };
 
+/// Holds a stack of any board size, 104 stones on 8x8.
+using Stack = BasicStack<u128>;
+
+/// The narrowest stack for a `Board<S>`, only 7x7 and 8x8 have enough pieces
+/// for a stack taller than 64.
+template <int S>
+using StackOf = BasicStack<std::conditional_t<(max_height<S> > 64), u128, u64>>;
+
 } // namespace eris
@@ -0,0 +1,108 @@
+#pragma once
+
+#include <atomic>
+#include <string_view>
+
+#include "types.hh"
+
+/// Counters of what the engine does on its hot paths, compiled in with
+/// `ERIS_STATS` (cmake -DERIS_STATS=ON). Without it every `stats::` call is an
+/// empty inline function.
+namespace eris::stats {
+
+#ifdef ERIS_STATS
+inline constexpr bool enabled = true;
+#else
+inline constexpr bool enabled = false;
+#endif
+
+enum Counter : u8 {
+  MAKE_PLACE,
+  MAKE_SPREAD,
+  /// Spreads that ended with a capstone flattening a wall.
+  MAKE_SMASH,
+  UNMAKE,
+  GENERATE,
+  ROAD,
+  /// Rounds of growing a group while splitting it, and of the road kernel.
+  FLOOD_ROUND,
+  PUT_STONE,
+  TAKE_STONE,
+  COUNTER_NB,
+};
+
+inline constexpr std::string_view counter_names[] = {
+  "make place", "make spread", "make smash",  "unmake",     "generate",
+  "road",       "flood round", "put stone",   "take stone",
+};
+static_assert(std::size(counter_names) == COUNTER_NB);
+
+struct Counters {
+  u64 counts[COUNTER_NB] = {};
+  /// Spread moves generated from each square.
+  u64 spreads[64] = {};
+  /// Largest `MoveList` filled by `generate_moves`.
+  u64 max_moves = 0;
+
+  auto merge(const Counters& other) -> void;
+};
+
+#ifdef ERIS_STATS
+/// One thread's counters, added to the process-wide total when the thread
+/// exits. `collect` and `reset` read and zero them from other threads while
+/// the owner counts, so they are atomics. Only the owner writes them
+/// though, with a relaxed load and store rather than a locked add, and a
+/// count racing with `reset` is at worst lost.
+struct ThreadCounters {
+  std::atomic<u64> counts[COUNTER_NB] = {};
+  std::atomic<u64> spreads[64] = {};
+  std::atomic<u64> max_moves = 0;
+
+  ThreadCounters();
+  ~ThreadCounters();
+
+  static auto add(std::atomic<u64>& counter, u64 n) -> void {
+    counter.store(counter.load(std::memory_order_relaxed) + n,
+                  std::memory_order_relaxed);
+  }
+
+  auto load() const -> Counters;
+  auto clear() -> void;
+};
+
+inline thread_local ThreadCounters local;
+#endif
+
+inline auto count(Counter c, u64 n = 1) -> void {
+#ifdef ERIS_STATS
+  ThreadCounters::add(local.counts[c], n);
+#else
+  static_cast<void>(c), static_cast<void>(n);
+#endif
+}
+
+inline auto count_spreads(int sq, u64 n) -> void {
+#ifdef ERIS_STATS
+  ThreadCounters::add(local.spreads[sq], n);
+#else
+  static_cast<void>(sq), static_cast<void>(n);
+#endif
+}
+
+inline auto track_moves(u64 n) -> void {
+#ifdef ERIS_STATS
+  if (n > local.max_moves.load(std::memory_order_relaxed)) {
+    local.max_moves.store(n, std::memory_order_relaxed);
+  }
+#else
+  static_cast<void>(n);
+#endif
+}
+
+/// Counters of every thread so far, live or exited.
+auto collect() -> Counters;
+auto reset() -> void;
+/// `collect()` as text, with the spreads laid out as a `size`x`size` board.
+auto report(int size) -> std::string;
+
+} // namespace eris::stats
@@ -1,33 +1,70 @@
 #pragma once
 
 #include "bitboard.hh"
+#include "move.hh"
 #include "square.hh"
 
 namespace eris {
 
+/// Squares of a `S`x`S` board that satisfy `fn`.
 template <int S>
-struct SquareCache {
-  Square<S> adjacent[4] = {};
-  u8 direction_bits = {};
-};
+constexpr auto squares_where(auto fn) -> Bitboard {
+  auto m = Bitboard();
+  for (int i = 0; i < S * S; ++i) {
+    if (fn(Square<S>(i))) {
+      m |= Square<S>(i);
+    }
+  }
+  return m;
+}
 
-#define SQUARE_CACHE(_S) square_cache##_S
+/// Squares along each edge of the board.
+template <int S>
+struct EdgeMasks {
+  u64 bottom = *squares_where<S>([](auto s) { return s.rank() == 0; });
+  u64 top = *squares_where<S>([](auto s) { return s.rank() == S - 1; });
+  u64 left = *squares_where<S>([](auto s) { return s.file() == 0; });
+  u64 right = *squares_where<S>([](auto s) { return s.file() == S - 1; });
+};
 
-#define X(_S) inline SquareCache<_S> SQUARE_CACHE(_S)[_S * _S] = {};
-BOARD_SIZE_ITER
-#undef X
+template <int S>
+inline constexpr auto edge_masks = EdgeMasks<S>();
 
+/// The squares next to every square. Where the board ends, `adjacent` holds
+/// the square itself and the direction's bit is left out of `direction_bits`.
 template <int S>
-constexpr auto orthogonally_adjacent_squares(int i) -> u8 {
-#define X(_S)                                                                  \
-  if constexpr (_S == S) {                                                     \
-    return SQUARE_CACHE(_S)[i].direction_bits;                                 \
+struct AdjacencyTable {
+  Square<S> adjacent[usize(S * S)][4] = {};
+  u8 direction_bits[usize(S * S)] = {};
+  u64 neighbours[usize(S * S)] = {};
+
+  constexpr AdjacencyTable() {
+    for (int i = 0; i < S * S; ++i) {
+      const auto square = Square<S>(i);
+      const bool open[4] = {
+        square.rank() != S - 1,
+        square.file() != S - 1,
+        square.rank() != 0,
+        square.file() != 0,
+      };
+      for (auto direction : { NORTH, EAST, SOUTH, WEST }) {
+        adjacent[i][direction] = square;
+        if (open[direction]) {
+          adjacent[i][direction] = square + direction;
+          direction_bits[i] |= u8(1 << direction);
+          neighbours[i] |= (square + direction).as_board();
+        }
+      }
+    }
   }
-  BOARD_SIZE_ITER
-#undef X
+};
+
+template <int S>
+inline constexpr auto adjacency_table = AdjacencyTable<S>();
 
-  auto s = S;
-  ASSERT(false, "unexpected board size `{}`", s);
+template <int S>
+constexpr auto orthogonally_adjacent_squares(int i) -> u8 {
+  return adjacency_table<S>.direction_bits[i];
 }
 
 template <int S>
@@ -36,49 +73,104 @@ constexpr auto orthogonally_adjacent_squares(Square<S> square) -> u8 {
 }
 
 template <int S>
-auto find_in_direction(Square<S> square, Direction direction) -> Square<S> {
-#define X(_S)                                                                  \
-  if constexpr (_S == S) {                                                     \
-    return SQUARE_CACHE(_S)[*square].adjacent[direction];                      \
-  }
-  BOARD_SIZE_ITER
-#undef X
+constexpr auto find_in_direction(Square<S> square, Direction direction)
+    -> Square<S> {
+  return adjacency_table<S>.adjacent[*square][direction];
 }
 
+/// Every way to spread a stack along one line, as `Move<S>` encodings with the
+/// square and direction left zero. Patterns only depend on how many stones may
+/// be picked up and how many free squares lie before the first blocker, so
+/// they are grouped by that distance and ordered by the number of stones picked
+/// up, which makes the patterns open to a carry limit `c` a prefix.
 template <int S>
-auto init_square_cache() -> void {
-  SquareCache<S>* arr = nullptr;
-#define X(_S)                                                                  \
-  if constexpr (_S == S) {                                                     \
-    arr = SQUARE_CACHE(_S);                                                    \
-  }
-  BOARD_SIZE_ITER
-#undef X
+struct SpreadTable {
+  static constexpr usize max_patterns = (1 << S) - 1;
 
-  for (const auto square : iter<S>(nbitmask(S * S))) {
-    u8 bits = 0;
-    auto& square_cache_entry = arr[*square];
-    for (int i = 0; i < 4; ++i) { square_cache_entry.adjacent[i] = square; }
+  struct Patterns {
+    u16 moves[max_patterns] = {};
+    u8 count[usize(S + 1)] = {};
 
-    if (square.rank() != 0) {
-      bits |= 1 << SOUTH;
-      square_cache_entry.adjacent[SOUTH] = square + SOUTH;
+    constexpr auto get(int carry) const -> std::span<const u16> {
+      return { moves, count[carry] };
     }
-    if (square.rank() != S - 1) {
-      bits |= 1 << NORTH;
-      square_cache_entry.adjacent[NORTH] = square + NORTH;
-    }
-    if (square.file() != 0) {
-      bits |= 1 << WEST;
-      square_cache_entry.adjacent[WEST] = square + WEST;
+  };
+
+  /// `spreads[d]` stay on the `d` free squares.
+  Patterns spreads[usize(S)] = {};
+  /// `smashes[d]` cross all `d` free squares and end with a capstone alone
+  /// flattening the wall behind them.
+  Patterns smashes[usize(S)] = {};
+
+  constexpr SpreadTable() {
+    for (int distance = 0; distance < S; ++distance) {
+      auto& spread = spreads[distance];
+      auto& smash = smashes[distance];
+      u8 nspreads = 0;
+      u8 nsmashes = 0;
+      for (int carry = 1; carry <= S; ++carry) {
+        // every split of `carry` stones into drops, one bit per cut
+        for (u32 cuts = 0; cuts < 1U << (carry - 1); ++cuts) {
+          const auto squares = std::popcount(cuts) + 1;
+          const auto last_drop = carry - int(std::bit_width(cuts));
+          if (squares <= distance) {
+            spread.moves[nspreads++] = encode(carry, cuts);
+          } else if (squares == distance + 1 and last_drop == 1) {
+            smash.moves[nsmashes++] = encode(carry, cuts);
+          }
+        }
+        spread.count[carry] = nspreads;
+        smash.count[carry] = nsmashes;
+      }
     }
-    if (square.file() != S - 1) {
-      bits |= 1 << EAST;
-      square_cache_entry.adjacent[EAST] = square + EAST;
+  }
+
+private:
+  static constexpr auto encode(int carry, u32 cuts) -> u16 {
+    auto pattern = Spread<S>();
+    pattern.push(carry, S);
+    auto held = carry;
+    for (int i = 1; i < carry; ++i) {
+      if (cuts & 1U << (i - 1)) {
+        auto drop = i - (carry - held);
+        pattern.push(held - drop, held);
+        held -= drop;
+      }
     }
+    pattern.push(0, held);
+    return u16(*pattern << 8);
+  }
+};
+
+template <int S>
+inline constexpr auto spread_table = SpreadTable<S>();
+
+/// Squares reachable from every square in a straight line, per direction,
+/// excluding the square itself.
+template <int S>
+struct RayTable {
+  u64 rays[usize(S * S)][4] = {};
 
-    square_cache_entry.direction_bits = bits;
+  constexpr RayTable() {
+    for (int i = 0; i < S * S; ++i) {
+      const auto square = Square<S>(i);
+      for (int r = square.rank() + 1; r < S; ++r) {
+        rays[i][NORTH] |= Square<S>(r, square.file()).as_board();
+      }
+      for (int f = square.file() + 1; f < S; ++f) {
+        rays[i][EAST] |= Square<S>(square.rank(), f).as_board();
+      }
+      for (int r = square.rank() - 1; r >= 0; --r) {
+        rays[i][SOUTH] |= Square<S>(r, square.file()).as_board();
+      }
+      for (int f = square.file() - 1; f >= 0; --f) {
+        rays[i][WEST] |= Square<S>(square.rank(), f).as_board();
+      }
+    }
   }
-}
+};
+
+template <int S>
+inline constexpr auto ray_table = RayTable<S>();
 
 } // namespace eris
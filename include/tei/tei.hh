@@ -6,6 +6,11 @@
 #include <thread>
 
 #include "board.hh"
+#include "mcts.hh"
+#include "perft.hh"
+#include "search.hh"
+#include "tinue.hh"
+#include "tt.hh"
 
 namespace eris {
 
@@ -35,9 +40,19 @@ private:
 
 struct GoCommand {
   int depth = 0;
-  int nodes = 0;
+  u64 nodes = 0;
+  /// Milliseconds on each player's clock and added after each move.
+  i64 time[COLOR_NB] = {};
+  i64 inc[COLOR_NB] = {};
+  i64 movetime = 0;
+  bool infinite = false;
+  /// Only look for a tinuë, see `Tei::tinue`.
+  bool tinue = false;
 };
 
+/// Search depth of a `go` without any limit or clock.
+constexpr int DEFAULT_DEPTH = 5;
+
 class Tei {
 public:
   Tei();
@@ -46,16 +61,29 @@ public:
 public:
   auto tick() -> void;
 
+  /// Plays a game on a `S`x`S` board until another `teinewgame`, which is
+  /// returned for `tick` to handle. Searches run on their own thread, so
+  /// commands are still read while one runs: `isready` is answered right
+  /// away and every other command stops the search first.
   template <int S>
-  auto teinewgame() -> void {
+  auto teinewgame() -> std::string {
     auto board = Board<S>();
+    // made by the first search with `Search` set to MCTS, and kept
+    auto tree = std::shared_ptr<Mcts<S>>();
     for (;;) {
       auto command = _ch.receive();
       auto tokens = split(command, ' ');
       auto cmd = tokens[0];
+      if (cmd == "isready") {
+        write("readyok");
+        continue;
+      }
+
+      stop_search();
       if (cmd == "position") {
         if (tokens[1] == "startpos") {
-          ASSERT(tokens[2] == "moves");
+          board = Board<S>();
+          ASSERT(tokens.size() == 2 or tokens[2] == "moves");
           for (usize i = 3; i < tokens.size(); ++i) {
             board.make_move(Move<S>(tokens[i]));
           }
@@ -64,49 +92,189 @@ public:
               "{}", fmt::join({ tokens[2], tokens[3], tokens[4] }, " "));
           board.tps(tps);
         }
+      } else if (cmd == "quit") {
+        std::exit(0);
       } else if (cmd == "stop") {
-        return;
-      } else if (cmd == "isready") {
-        write("readyok");
+        // the search, if there was one, wrote its move
+      } else if (cmd == "teinewgame") {
+        return command;
+      } else if (cmd == "setoption") {
+        setoption(tokens);
+      } else if (cmd == "perft") {
+        auto depth = std::stoi(tokens.at(1));
+        auto [duration, nodes] =
+            timeit<usize>([&] { return perft<S>(board, depth); });
+        write(fmt::format("info depth {} nodes {} time {:.0f} nps {:.0f}",
+                          depth, nodes, duration.millis(),
+                          f64(nodes) / duration.secs()));
+      } else if (cmd == "stats") {
+        // `stats reset` starts the counts over, `stats` prints them
+        if (tokens.size() > 1 and tokens[1] == "reset") {
+          stats::reset();
+        } else {
+          fmt::print("{}", stats::report(S));
+        }
       } else if (cmd == "go") {
-        auto get_n = [&](usize n) { return std::stoi(tokens[n]); };
+        auto get_n = [&](usize n) { return i64(std::stoll(tokens.at(n))); };
         auto gocmd = GoCommand();
         usize i = 1;
         while (i < tokens.size()) {
           const auto& sub = tokens[i];
+          i64* value = nullptr;
           if (sub == "depth") {
-            gocmd.depth = get_n(i + 1);
-            i += 2;
-            continue;
+            gocmd.depth = int(get_n(i + 1));
           } else if (sub == "nodes") {
-            gocmd.nodes = get_n(i + 1);
-            i += 2;
+            gocmd.nodes = u64(std::max(get_n(i + 1), i64(0)));
+          } else if (sub == "wtime") {
+            value = &gocmd.time[WHITE];
+          } else if (sub == "btime") {
+            value = &gocmd.time[BLACK];
+          } else if (sub == "winc") {
+            value = &gocmd.inc[WHITE];
+          } else if (sub == "binc") {
+            value = &gocmd.inc[BLACK];
+          } else if (sub == "movetime") {
+            value = &gocmd.movetime;
+          } else if (sub == "infinite" or sub == "tinue") {
+            (sub == "tinue" ? gocmd.tinue : gocmd.infinite) = true;
+            i += 1;
             continue;
           } else {
             fmt::println(stderr, "unknown subcommand in go: `{}`", sub);
+            i += 1;
+            continue;
+          }
+          if (value) {
+            *value = get_n(i + 1);
           }
-          i += 1;
+          i += 2;
         }
-        go(board, gocmd);
+        if (_mcts and (not tree or tree->size_mb() != _tree_mb)) {
+          tree = std::make_shared<Mcts<S>>(_tree_mb);
+        }
+        if (tree and tree->threads() != _threads) {
+          tree->set_threads(_threads);
+        }
+        gocmd.tinue ? tinue(board, gocmd)
+                    : go(board, gocmd, _mcts ? tree : nullptr);
       } else {
         fmt::println(stderr, "unknown command: `{}`", cmd);
       }
     }
   }
 
+  /// Starts searching `board` on the search thread, which writes `bestmove`
+  /// when it is done. After `go infinite` that waits for `stop`. The search
+  /// plays out `tree` when there is one, and is alpha-beta otherwise.
   template <int S>
-  auto go(Board<S>& board, GoCommand cmd) -> void {
-    auto moves = MoveList<S>();
-    board.generate_moves(moves);
-    fmt::println(stderr, "{} {}", cmd.depth, cmd.nodes);
+  auto go(const Board<S>& board, GoCommand cmd,
+          std::shared_ptr<Mcts<S>> tree = {}) -> void {
+    const auto us = board.turn();
+    auto limits = SearchLimits{
+      .depth = cmd.depth,
+      .nodes = cmd.nodes,
+      .time = cmd.time[us],
+      .inc = cmd.inc[us],
+      .movetime = cmd.movetime,
+      .infinite = cmd.infinite,
+    };
+    if (not limits.nodes and not limits.time and not limits.movetime and
+        not limits.infinite) {
+      // the tree search has no depth to stop at
+      if (tree) {
+        limits.nodes = mcts::DEFAULT_PLAYOUTS;
+      } else if (not limits.depth) {
+        limits.depth = DEFAULT_DEPTH;
+      }
+    }
+
+    auto report = [this](const SearchInfo<S>& info) {
+      auto score = is_win(info.score)
+                       ? fmt::format("mate {}", moves_to_win(info.score))
+                       : fmt::format("cp {}", info.score);
+      write(fmt::format("info depth {} score {} nodes {} time {:.0f} "
+                        "nps {:.0f} hashfull {} pv {}",
+                        info.depth, score, info.nodes, info.time.millis(),
+                        f64(info.nodes) / std::max(info.time.secs(), 1e-9),
+                        info.hashfull, fmt::join(info.pv, " ")));
+    };
+    auto run = std::function<Move<S>()>();
+    if (tree) {
+      // the tree outlives the search, a stop once it is over is not for
+      // the next one
+      _stop_search = [tree, search = tree->searches()] { tree->stop(search); };
+      run = [=] { return tree->go(board, limits, report); };
+    } else {
+      auto search = std::make_shared<Search<S>>(_tt, _threads, &_tinue);
+      _stop_search = [search] { search->stop(); };
+      run = [=] { return search->go(board, limits, report); };
+    }
+    _searcher = std::thread([this, run, limits] {
+      auto best = run();
+      if (limits.infinite) {
+        _stopping.wait(false);
+      }
+      write(fmt::format("bestmove {}", best));
+    });
+  }
+
+  /// Looks for a tinuë of the side to move on the search thread, until it is
+  /// settled, `stop`, or the `nodes` or `movetime` of `cmd` run out. A tinuë
+  /// is written as a mate with its line and `bestmove`, anything else as an
+  /// `info string`.
+  template <int S>
+  auto tinue(const Board<S>& board, GoCommand cmd) -> void {
+    auto solver = std::make_shared<TinueSolver<S>>(_tinue);
+    _stop_search = [solver] { solver->stop(); };
+    _searcher = std::thread([this, solver, board, cmd] {
+      auto limits = TinueLimits{ .nodes = cmd.nodes, .movetime = cmd.movetime };
+      auto [duration, result] = timeit<TinueResult>(
+          [&] { return solver->solve(board, limits); });
+      auto nodes = solver->nodes();
+      auto pv = solver->pv();
+      auto stats = fmt::format("nodes {} time {:.0f} nps {:.0f}", nodes,
+                               duration.millis(),
+                               f64(nodes) / std::max(duration.secs(), 1e-9));
+      if (result == TINUE_PROVEN and not pv.empty()) {
+        write(fmt::format("info depth {} score mate {} {} pv {}", pv.size(),
+                          (pv.size() + 1) / 2, stats, fmt::join(pv, " ")));
+        write(fmt::format("bestmove {}", pv[0]));
+      } else {
+        write(fmt::format("info string {} {}",
+                          result == TINUE_DISPROVEN ? "no tinue"
+                                                    : "tinue unknown",
+                          stats));
+      }
+    });
   }
 
 private:
-  auto write(std::string msg) -> void { fmt::println("{}", msg); }
+  /// One line to the GUI, whole even when the search thread writes too.
+  auto write(std::string msg) -> void {
+    auto lock = std::lock_guard(_write_mtx);
+    fmt::println("{}", msg);
+    std::fflush(stdout);
+  }
+  auto setoption(const std::vector<std::string>& tokens) -> void;
+  /// Stops the running search, if any, once it has written its move.
+  auto stop_search() -> void;
 
 private:
   Channel<std::string> _ch = {};
+  TranspositionTable _tt;
+  TinueTable _tinue;
+  /// Threads of a search, see `Search`.
+  int _threads = 1;
+  /// Search with `Mcts` rather than `Search`, in a tree of `_tree_mb`.
+  bool _mcts = false;
+  usize _tree_mb = mcts::DEFAULT_MB;
   std::thread _thread;
+
+  std::thread _searcher;
+  std::function<void()> _stop_search;
+  /// Set while `stop_search` waits for the search thread.
+  std::atomic<bool> _stopping = false;
+  std::mutex _write_mtx;
 };
 
 } // namespace eris
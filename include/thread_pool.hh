@@ -0,0 +1,54 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+
+namespace eris {
+
+/// Fixed-size pool where every worker owns a task queue. Workers run their own
+/// queue newest-first and, once it is empty, steal the oldest task from the
+/// other queues, so uneven subtrees still keep all threads busy.
+class ThreadPool {
+public:
+  using Task = std::function<void()>;
+
+  explicit ThreadPool(usize nthreads = std::thread::hardware_concurrency());
+  ~ThreadPool();
+  DISALLOW_COPY_AND_ASSIGN(ThreadPool);
+
+  auto size() const -> usize { return _threads.size(); }
+
+  auto submit(Task task) -> void;
+  /// Blocks until every submitted task has finished.
+  auto wait() -> void;
+
+private:
+  struct Queue {
+    std::mutex mtx;
+    std::deque<Task> tasks;
+  };
+
+  auto worker(usize id) -> void;
+  auto try_pop(usize id, Task& task) -> bool;
+
+private:
+  std::vector<std::thread> _threads;
+  std::unique_ptr<Queue[]> _queues;
+
+  std::mutex _mtx;
+  std::condition_variable _work_cv;
+  std::condition_variable _done_cv;
+  /// Tasks in the queues that no worker has claimed, guarded by `_mtx`.
+  usize _queued = 0;
+
+  std::atomic<usize> _pending = 0;
+  std::atomic<usize> _next = 0;
+  bool _stop = false;
+};
+
+} // namespace eris
@@ -0,0 +1,26 @@
+#pragma once
+
+namespace eris {
+
+/// Milliseconds a search may take from its start, 0 for no limit.
+struct TimeBudget {
+  /// No iteration starts past this, scaled by `stability_scale`.
+  i64 soft = 0;
+  /// The search stops here, even in the middle of an iteration.
+  i64 hard = 0;
+};
+
+/// Kept back from every move for reading `go` and writing `bestmove`.
+constexpr i64 MOVE_OVERHEAD = 10;
+
+/// Splits `time` left on the clock, plus `inc` per move, over `moves_left`
+/// moves. A `movetime` is used as it is.
+auto time_budget(i64 time, i64 inc, i64 movetime, int moves_left)
+    -> TimeBudget;
+
+/// How much of the soft limit to use once the best move stayed the same for
+/// `stable` iterations in a row: more while it keeps changing, less once it
+/// settles.
+auto stability_scale(int stable) -> f64;
+
+} // namespace eris
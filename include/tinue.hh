@@ -0,0 +1,350 @@
+#pragma once
+
+#include <atomic>
+#include <memory>
+
+#include "eval.hh"
+
+namespace eris {
+
+/// Proof or disproof number of a settled node.
+constexpr u32 PN_INF = 1u << 30;
+
+struct TinueEntry {
+  u64 key = 0;
+  /// Leaves still to prove, or to disprove, that the attacker has a tinuë.
+  u32 pn = 1;
+  u32 dn = 1;
+  /// Nodes expanded under this one, the entries worth the most to keep.
+  u32 work = 0;
+  /// A `Move<S>` encoding: the winning move of a proven attacker node, the
+  /// longest defence of a proven defender node, 0 for none.
+  u16 move = 0;
+};
+
+/// Proof and disproof numbers of the positions a `TinueSolver` looked at,
+/// kept apart from the search's table. Buckets of a few entries, of which a
+/// new one replaces its own key or else the one with the least work.
+class TinueTable {
+public:
+  static constexpr usize default_mb = 16;
+
+  explicit TinueTable(usize mb = default_mb);
+  DISALLOW_COPY_AND_ASSIGN(TinueTable);
+
+  auto resize(usize mb) -> void;
+  auto clear() -> void;
+
+  /// The entry for `key`, a fresh one with both numbers 1 when there is none.
+  auto probe(u64 key) const -> TinueEntry;
+  auto store(const TinueEntry& entry) -> void;
+
+private:
+  static constexpr usize SLOTS = 4;
+
+  struct Bucket {
+    TinueEntry slots[SLOTS];
+  };
+
+  auto bucket(u64 key) const -> Bucket& {
+    return _buckets[usize((u128(key) * _count) >> 64)];
+  }
+
+private:
+  std::unique_ptr<Bucket[]> _buckets;
+  usize _count = 0;
+};
+
+enum TinueResult : u8 {
+  TINUE_UNKNOWN,
+  /// The side to move wins by a series of road threats.
+  TINUE_PROVEN,
+  /// It has no such series, though it may still win otherwise.
+  TINUE_DISPROVEN,
+};
+
+struct TinueLimits {
+  /// Nodes to expand and milliseconds to take at most, 0 for no limit.
+  u64 nodes = 0;
+  i64 movetime = 0;
+};
+
+/// Deepest line a tinuë is looked for in. `Board` can unmake the last 64
+/// moves.
+constexpr int TINUE_MAX_PLY = 64;
+
+/// Depth-first proof-number search for a tinuë of the side to move: a road
+/// it forces by threatening one every move. The attacker only plays moves
+/// after which it has a road in one, the defender only moves after which it
+/// no longer does, so the tree stays narrow however deep the tinuë goes.
+///
+/// An attacker node is proven once one of its moves is, a defender node once
+/// every move is. Each node is searched until its numbers pass thresholds
+/// from its parent, then its parent picks the most promising child again.
+/// Thresholds for a child leave it room up to a quarter past its best
+/// sibling's numbers (the 1 + ε trick), so the search does not keep hopping
+/// between two close siblings.
+///
+/// A position already on the line counts as disproven, the attacker gains
+/// nothing by repeating it. That is only true on this line, so a disproof
+/// may be too strong, but a proof never is.
+template <int S>
+class TinueSolver {
+public:
+  explicit TinueSolver(TinueTable& table) : _table(table) {}
+
+  /// Searches `board` until the side to move is proven to have a tinuë or
+  /// not, a limit is hit, or `stop` is called.
+  auto solve(const Board<S>& board, TinueLimits limits = {}) -> TinueResult {
+    _board = board;
+    _attacker = board.turn();
+    _salt = _attacker == WHITE ? 0 : zobrist<S>.black_attacks;
+    _limits = limits;
+    _start = chr::steady_clock::now();
+    _nodes = 0;
+    _stopped = false;
+    _path.assign(1, board.hash());
+    _children.clear();
+    if (board.first_move()) {
+      return TINUE_UNKNOWN;
+    }
+
+    auto root = _mid(PN_INF, PN_INF, 0);
+    _stop = false;
+    return root.pn == 0   ? TINUE_PROVEN
+           : root.dn == 0 ? TINUE_DISPROVEN
+                          : TINUE_UNKNOWN;
+  }
+
+  /// Ends the running `solve`, or the next one. Safe to call from any thread.
+  auto stop() -> void { _stop = true; }
+
+  auto nodes() const -> u64 { return _nodes; }
+
+  /// The tinuë after a proof: the winning moves of the attacker and the
+  /// longest defences, as far as the table still holds them.
+  auto pv() const -> std::vector<Move<S>> {
+    auto board = _board;
+    auto line = std::vector<Move<S>>();
+    while (line.size() < usize(TINUE_MAX_PLY)) {
+      auto entry = _table.probe(board.hash() ^ _salt);
+      if (entry.pn != 0 or not entry.move) {
+        // the road that ends it was never looked up, only seen to be there
+        auto win = _road_placement(board);
+        auto spreads = MoveList<S>();
+        board.road_spreads(spreads);
+        if (win == Move<S>::none() and spreads.size()) {
+          win = spreads[0];
+        }
+        if (board.turn() == _attacker and win != Move<S>::none()) {
+          line.push_back(win);
+        }
+        break;
+      }
+      line.push_back(Move<S>(entry.move));
+      board.make_move(line.back());
+    }
+    return line;
+  }
+
+private:
+  struct Child {
+    Move<S> move;
+    u64 key;
+    /// Repeats the line or goes too deep, disproven wherever it is looked up.
+    bool dead;
+  };
+
+  /// Searches the node on `_board` until its proof number reaches
+  /// `pn_limit` or its disproof number `dn_limit`, and returns its numbers.
+  auto _mid(u32 pn_limit, u32 dn_limit, int ply) -> TinueEntry {
+    const auto start = _nodes++;
+    const auto key = _board.hash() ^ _salt;
+    const auto attacker = _board.turn() == _attacker;
+    const auto begin = _children.size();
+
+    auto node = _expand(attacker, ply);
+    node.key = key;
+    auto best = begin;
+    while (node.pn and node.dn) {
+      // attacker nodes take the child with the lowest proof number, defender
+      // nodes the one with the lowest disproof number
+      best = begin;
+      auto best_pn = PN_INF, best_dn = PN_INF, second = PN_INF;
+      auto sum = u32(0);
+      for (auto i = begin; i < _children.size(); ++i) {
+        auto [pn, dn] = _numbers(_children[i]);
+        auto [pick, add] = attacker ? std::pair(pn, dn) : std::pair(dn, pn);
+        sum = std::min(sum + add, PN_INF);
+        if (pick < (attacker ? best_pn : best_dn)) {
+          second = attacker ? best_pn : best_dn;
+          best = i;
+          best_pn = pn;
+          best_dn = dn;
+        } else if (pick < second) {
+          second = pick;
+        }
+      }
+      node.pn = attacker ? best_pn : sum;
+      node.dn = attacker ? sum : best_dn;
+      if (node.pn >= pn_limit or node.dn >= dn_limit or _out_of_budget()) {
+        break;
+      }
+
+      auto child_pn = pn_limit, child_dn = dn_limit;
+      auto room = u32(std::min(u64(second) + second / 4 + 1, u64(PN_INF)));
+      if (attacker) {
+        child_pn = std::min(pn_limit, room);
+        child_dn = dn_limit - node.dn + best_dn;
+      } else {
+        child_pn = pn_limit - node.pn + best_pn;
+        child_dn = std::min(dn_limit, room);
+      }
+      const auto move = _children[best].move;
+      _board.make_move(move);
+      _path.push_back(_board.hash());
+      _mid(child_pn, child_dn, ply + 1);
+      _path.pop_back();
+      _board.unmake_move(move);
+    }
+
+    if (node.pn == 0 and not node.move and _children.size() > begin) {
+      node.move = *(attacker ? _children[best].move : _longest_defence(begin));
+    }
+    node.work = u32(std::min(_nodes - start, u64(~u32(0))));
+    _table.store(node);
+    _children.resize(begin);
+    return node;
+  }
+
+  /// Pushes the children of the node on `_board` to `_children` and returns
+  /// its numbers, already settled when a move ends the game or no child is
+  /// left.
+  auto _expand(bool attacker, int ply) -> TinueEntry {
+    auto node = TinueEntry();
+    auto settle = [&](bool proven, Move<S> move) {
+      node.pn = proven ? 0 : PN_INF;
+      node.dn = proven ? PN_INF : 0;
+      node.move = *move;
+      return node;
+    };
+
+    if (attacker) {
+      if (auto win = _road_placement(_board); win != Move<S>::none()) {
+        return settle(true, win);
+      }
+    }
+
+    const auto begin = _children.size();
+    auto moves = MoveList<S>();
+    _board.generate_moves(moves);
+    for (auto move : moves) {
+      _board.make_move(move);
+      auto keep = false;
+      if (auto result = game_result(_board, 0)) {
+        // the result is for the side to move, the one that did not move,
+        // and a draw is as good as a win for the defender
+        if (attacker ? *result < 0 : *result <= 0) {
+          _board.unmake_move(move);
+          _children.resize(begin);
+          return settle(attacker, attacker ? move : Move<S>::none());
+        }
+      } else {
+        // the attacker threatens a road after its moves and no longer
+        // does after the defender's
+        keep = _threatens(_attacker) == attacker;
+      }
+      if (keep) {
+        auto key = _board.hash();
+        auto dead = ply + 1 >= TINUE_MAX_PLY or
+                    rng::find(_path, key) != _path.end();
+        _children.push_back({ move, key ^ _salt, dead });
+      }
+      _board.unmake_move(move);
+    }
+
+    if (_children.size() == begin) {
+      // a defender with no move that stops the road still has to move
+      return settle(not attacker, attacker ? Move<S>::none() : moves[0]);
+    }
+    return node;
+  }
+
+  /// A placement that completes a road for the side to move, none if there
+  /// is no such square.
+  static auto _road_placement(const Board<S>& board) -> Move<S> {
+    const auto us = board.turn();
+    auto squares = board.road_placements(us);
+    if (squares.empty()) {
+      return Move<S>::none();
+    }
+    auto stone = board.reserves(us) > board.caps_in_hand(us) ? FLAT : CAP;
+    return Move<S>::place(Square<S>(lsb(*squares)), stone);
+  }
+
+  /// Whether `c` has a road in one on `_board`, whoever is to move.
+  auto _threatens(Color c) const -> bool {
+    if (not _board.road_placements(c).empty()) {
+      return true;
+    }
+    auto spreads = MoveList<S>();
+    _board.road_spreads(c, spreads);
+    return spreads.size() > 0;
+  }
+
+  auto _numbers(const Child& child) const -> std::pair<u32, u32> {
+    if (child.dead) {
+      return { PN_INF, 0 };
+    }
+    auto entry = _table.probe(child.key);
+    return { entry.pn, entry.dn };
+  }
+
+  /// Of the children from `begin`, the one proven with the most work.
+  auto _longest_defence(usize begin) const -> Move<S> {
+    auto longest = Move<S>::none();
+    auto most = u32(0);
+    for (auto i = begin; i < _children.size(); ++i) {
+      auto entry = _table.probe(_children[i].key);
+      if (entry.pn == 0 and entry.work >= most) {
+        longest = _children[i].move;
+        most = entry.work;
+      }
+    }
+    return longest;
+  }
+
+  auto _out_of_budget() -> bool {
+    if (_stopped) {
+      return true;
+    }
+    if (_stop.load(std::memory_order_relaxed) or
+        (_limits.nodes and _nodes >= _limits.nodes)) {
+      _stopped = true;
+    } else if (_limits.movetime) {
+      auto elapsed = chr::steady_clock::now() - _start;
+      _stopped = elapsed >= chr::milliseconds(_limits.movetime);
+    }
+    return _stopped;
+  }
+
+  TinueTable& _table;
+  Board<S> _board;
+  Color _attacker = WHITE;
+  /// Tells the attacker's positions apart from the same ones with the
+  /// other side attacking.
+  u64 _salt = 0;
+  TinueLimits _limits;
+  chr::steady_clock::time_point _start;
+  u64 _nodes = 0;
+  bool _stopped = false;
+  std::atomic<bool> _stop = false;
+
+  /// Keys of the positions from the root to the current node.
+  std::vector<u64> _path;
+  /// The children of every node on the line, each node's after its
+  /// parent's.
+  std::vector<Child> _children;
+};
+
+} // namespace eris
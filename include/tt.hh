@@ -0,0 +1,85 @@
+#pragma once
+
+#include <atomic>
+#include <memory>
+#include <optional>
+
+namespace eris {
+
+enum Bound : u8 {
+  BOUND_NONE,
+  /// The score is at most this, every move failed low.
+  BOUND_UPPER,
+  /// The score is at least this, a move failed high.
+  BOUND_LOWER,
+  BOUND_EXACT,
+};
+
+struct TTEntry {
+  /// A `Move<S>` encoding, 0 for none.
+  u16 move = 0;
+  i16 score = 0;
+  u8 depth = 0;
+  Bound bound = BOUND_NONE;
+};
+
+/// Transposition table shared by every search thread without locks. Each slot
+/// is two words, the entry and the key xor'ed with it, written with relaxed
+/// stores. A slot torn by two threads writing at once no longer verifies and
+/// reads as a miss.
+///
+/// Slots come in buckets of one cache line. A new entry replaces its own key,
+/// or else the slot whose entry is the shallowest, counting every search since
+/// it was written as a few plies less.
+class TranspositionTable {
+public:
+  static constexpr usize default_mb = 16;
+
+  explicit TranspositionTable(usize mb = default_mb);
+  DISALLOW_COPY_AND_ASSIGN(TranspositionTable);
+
+  /// Reallocates the table to `mb` megabytes, dropping every entry.
+  auto resize(usize mb) -> void;
+  auto clear() -> void;
+  /// Entries from earlier searches become the first to be replaced.
+  auto new_search() -> void { _age = u8((_age + 1) & AGE_MASK); }
+
+  auto probe(u64 key) const -> std::optional<TTEntry>;
+  auto store(u64 key, TTEntry entry) -> void;
+
+  /// Permille of the table written by the current search, from a sample.
+  auto hashfull() const -> int;
+  auto size_mb() const -> usize { return _mb; }
+
+private:
+  struct Slot {
+    std::atomic<u64> check;
+    std::atomic<u64> data;
+  };
+
+  static constexpr usize SLOTS = 4;
+
+  struct alignas(64) Bucket {
+    Slot slots[SLOTS];
+  };
+  static_assert(sizeof(Bucket) == 64);
+
+  static constexpr u8 AGE_MASK = 0x3f;
+
+  /// move:16 score:16 depth:8 bound:2 age:6
+  static auto pack(TTEntry entry, u8 age) -> u64;
+  static auto unpack(u64 data) -> TTEntry;
+  static auto age_of(u64 data) -> u8 { return u8(data >> 42) & AGE_MASK; }
+
+  auto bucket(u64 key) const -> Bucket& {
+    return _buckets[usize((u128(key) * _count) >> 64)];
+  }
+
+private:
+  std::unique_ptr<Bucket[]> _buckets;
+  usize _count = 0;
+  usize _mb = 0;
+  u8 _age = 0;
+};
+
+} // namespace eris
@@ -12,6 +12,14 @@ namespace eris {
 
 constexpr u64 EMPTY = 0ULL;
 
+static constexpr u8 starting_stones[] = { 10, 15, 21, 30, 40, 50 };
+static constexpr u8 starting_caps[] = { 0, 0, 1, 1, 2, 2 };
+
+/// Most stones a single square can hold, every piece of both players.
+template <int S>
+inline constexpr int max_height =
+    2 * (starting_stones[S - 3] + starting_caps[S - 3]);
+
 /// STONE TYPES
 enum StoneType : u8 {
   NO_STONE_TYPE = 0,
@@ -0,0 +1,95 @@
+#pragma once
+
+#include <algorithm>
+
+#include "square.hh"
+
+namespace eris {
+
+/// Hundredths of a flat.
+using Score = i32;
+
+/// Weights of the handcrafted evaluation. Arrays indexed by `S - 3` are set
+/// per board size, those indexed by `StoneType` by the stone on top.
+namespace weights {
+
+constexpr Score FLAT[] = { 100, 100, 100, 100, 100, 100 };
+constexpr Score WALL[] = { 55, 50, 45, 42, 40, 38 };
+constexpr Score CAP[] = { 0, 0, 75, 80, 85, 85 };
+/// Per step a stone on top stands away from the edge.
+constexpr Score CENTER_FLAT[] = { 6, 5, 4, 4, 3, 3 };
+constexpr Score CENTER_WALL[] = { 2, 2, 2, 2, 1, 1 };
+constexpr Score CENTER_CAP[] = { 0, 0, 12, 10, 9, 8 };
+
+/// Per stone under the top one that a spread picks up with it: of the top's
+/// color (a hard support), and of the other (a captive).
+constexpr Score HARD[] = { 0, 15, 20, 25 };
+constexpr Score CAPTIVE[] = { 0, -10, 5, 10 };
+/// Per stone of the top's color buried deeper than a spread reaches.
+constexpr Score SOFT[] = { 0, 4, 4, 4 };
+
+/// For each color, per rank or file it has road stones in, by the stones it
+/// still misses there.
+constexpr Score LINE[] = { 100, 60, 30, 12, 4 };
+/// Per group, by the number of ranks or files it spans, whichever is larger.
+constexpr Score EXTENT[] = { 0, 0, 15, 40, 80, 130, 190, 260, 340 };
+
+/// Per stone of the other color next to a wall or a capstone, on its way
+/// to a road.
+constexpr Score WALL_BLOCK[] = { 6, 8, 10, 10, 10, 10 };
+constexpr Score CAP_BLOCK[] = { 0, 0, 15, 15, 15, 15 };
+
+/// Per stone and capstone in hand.
+constexpr Score RESERVE[] = { 4, 4, 4, 4, 4, 4 };
+constexpr Score CAP_RESERVE[] = { 0, 0, 30, 30, 25, 25 };
+/// Added to each flat of a lead on top, a share of it by how far the smaller
+/// reserve has run down, all of it once that reserve is empty.
+constexpr Score FLAT_LEAD[] = { 80, 80, 70, 60, 60, 60 };
+
+} // namespace weights
+
+/// The weights of a `S`x`S` board spread over the squares and counts they
+/// are looked up by.
+template <int S>
+struct EvalTables {
+  static constexpr int reserve = starting_stones[S - 3] + starting_caps[S - 3];
+
+  /// What each stone is worth on top of each square, for white, so black's
+  /// count against it.
+  Score top[STONE_NB][usize(S * S)] = {};
+  /// By the road stones of one color in a rank or file.
+  Score line[usize(S + 1)] = {};
+  /// Per flat of a lead on top, by the smaller of the two reserves.
+  Score flat_lead[usize(reserve + 1)] = {};
+
+  constexpr EvalTables() {
+    const Score base[] = { 0, weights::FLAT[S - 3], weights::WALL[S - 3],
+                           weights::CAP[S - 3] };
+    const Score center[] = { 0, weights::CENTER_FLAT[S - 3],
+                             weights::CENTER_WALL[S - 3],
+                             weights::CENTER_CAP[S - 3] };
+    for (int i = 0; i < S * S; ++i) {
+      const auto sq = Square<S>(i);
+      const auto ring = std::min({ sq.rank(), sq.file(), S - 1 - sq.rank(),
+                                   S - 1 - sq.file() });
+      for (auto type : { FLAT, WALL, CAP }) {
+        top[mk_stone(type, WHITE)][i] = base[type] + center[type] * ring;
+        top[mk_stone(type, BLACK)][i] = -top[mk_stone(type, WHITE)][i];
+      }
+    }
+
+    constexpr auto lines = int(std::size(weights::LINE));
+    for (int n = 1; n <= S; ++n) {
+      line[n] = S - n < lines ? weights::LINE[S - n] : 0;
+    }
+
+    for (int left = 0; left <= reserve; ++left) {
+      flat_lead[left] = weights::FLAT_LEAD[S - 3] * (reserve - left) / reserve;
+    }
+  }
+};
+
+template <int S>
+inline constexpr auto eval_tables = EvalTables<S>();
+
+} // namespace eris
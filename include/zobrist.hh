@@ -0,0 +1,52 @@
+#pragma once
+
+#include "types.hh"
+
+namespace eris {
+
+/// Zobrist keys for a `Board<S>`. Buried stones are keyed by their height
+/// from the bottom of the stack and only white ones contribute, and every
+/// stack also carries the key of its height, so pushing or popping a stone
+/// touches at most three keys.
+template <int S>
+struct Zobrist {
+  u64 top[usize(S * S)][STONE_NB] = {};
+  u64 buried[usize(S * S)][usize(max_height<S>)] = {};
+  u64 height[usize(S * S)][usize(max_height<S> + 1)] = {};
+  u64 black_to_move = 0ULL;
+  u64 first_move = 0ULL;
+  /// Not part of a position, it keys the tinuë search of black apart from
+  /// that of white.
+  u64 black_attacks = 0ULL;
+
+  constexpr Zobrist() {
+    // splitmix64
+    auto state = 0x9e3779b97f4a7c15ULL * u64(S);
+    auto next = [&] {
+      auto z = (state += 0x9e3779b97f4a7c15ULL);
+      z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ULL;
+      z = (z ^ (z >> 27)) * 0x94d049bb133111ebULL;
+      return z ^ (z >> 31);
+    };
+
+    for (auto& keys : top) {
+      for (auto st : { B_FLAT, B_WALL, B_CAP, W_FLAT, W_WALL, W_CAP }) {
+        keys[st] = next();
+      }
+    }
+    for (auto& keys : buried) {
+      for (auto& key : keys) { key = next(); }
+    }
+    for (auto& keys : height) {
+      for (usize h = 1; h < std::size(keys); ++h) { keys[h] = next(); }
+    }
+    black_to_move = next();
+    first_move = next();
+    black_attacks = next();
+  }
+};
+
+template <int S>
+inline constexpr auto zobrist = Zobrist<S>();
+
+} // namespace eris
@@ -0,0 +1,217 @@
+#include <algorithm>
+#include <cmath>
+#include <fstream>
+#include <map>
+#include <regex>
+
+#include "perft.hh"
+
+using namespace eris;
+
+namespace {
+
+struct Position {
+  std::string name;
+  int size = 0;
+  int depth = 0;
+  usize nodes = 0;
+  std::string tps;
+};
+
+struct Result {
+  f64 median = 0;
+  f64 stddev = 0;
+  f64 millis = 0;
+};
+
+struct Options {
+  std::string suite = ERIS_BENCH_SUITE;
+  std::string json;
+  std::string compare;
+  int warmup = 1;
+  int reps = 5;
+  /// Slowdown of a position's median, in percent, reported as a regression.
+  f64 threshold = 5;
+};
+
+auto usage() -> void {
+  fmt::println(stderr, "usage: bench [--suite FILE] [--reps N] [--warmup N] "
+                       "[--json FILE] [--compare FILE] [--threshold PCT]");
+  std::exit(2);
+}
+
+auto parse_options(int argc, char** argv) -> Options {
+  auto options = Options();
+  for (int i = 1; i < argc; ++i) {
+    auto arg = std::string(argv[i]);
+    if (i + 1 == argc) {
+      usage();
+    }
+    auto value = std::string(argv[++i]);
+    if (arg == "--suite") {
+      options.suite = value;
+    } else if (arg == "--reps") {
+      options.reps = std::stoi(value);
+    } else if (arg == "--warmup") {
+      options.warmup = std::stoi(value);
+    } else if (arg == "--json") {
+      options.json = value;
+    } else if (arg == "--compare") {
+      options.compare = value;
+    } else if (arg == "--threshold") {
+      options.threshold = std::stod(value);
+    } else {
+      usage();
+    }
+  }
+  if (options.reps < 1 or options.warmup < 0) {
+    usage();
+  }
+  return options;
+}
+
+/// Lines of `size depth nodes name tps`, `#` starts a comment.
+auto load_suite(const std::string& path) -> std::vector<Position> {
+  auto file = std::ifstream(path);
+  ASSERT(file, "cannot open suite `{}`", path);
+
+  auto positions = std::vector<Position>();
+  auto line = std::string();
+  while (std::getline(file, line)) {
+    if (line.empty() or line[0] == '#') {
+      continue;
+    }
+    auto p = Position();
+    auto ss = std::istringstream(line);
+    ss >> p.size >> p.depth >> p.nodes >> p.name >> std::ws;
+    std::getline(ss, p.tps);
+    ASSERT(ss and p.size >= 3 and p.size <= 8, "bad suite line `{}`", line);
+    positions.push_back(std::move(p));
+  }
+  return positions;
+}
+
+template <int S>
+auto run(const Position& p, const Options& options) -> Result {
+  auto board = Board<S>::from(p.tps);
+  auto mnps = std::vector<f64>();
+  auto millis = std::vector<f64>();
+  for (int i = 0; i < options.warmup + options.reps; ++i) {
+    auto [duration, nodes] =
+        timeit<usize>([&] { return perft<S>(board, p.depth); });
+    ASSERT(nodes == p.nodes, "{}: perft {} != {}", p.name, nodes, p.nodes);
+    if (i >= options.warmup) {
+      mnps.push_back(f64(nodes) / duration.micros());
+      millis.push_back(duration.millis());
+    }
+  }
+
+  auto median = [](std::vector<f64> v) {
+    rng::sort(v);
+    auto n = v.size();
+    return n % 2 ? v[n / 2] : (v[n / 2 - 1] + v[n / 2]) / 2;
+  };
+  auto mean = 0.0;
+  for (auto x : mnps) { mean += x; }
+  mean /= f64(mnps.size());
+  auto variance = 0.0;
+  for (auto x : mnps) { variance += (x - mean) * (x - mean); }
+  if (mnps.size() > 1) {
+    variance /= f64(mnps.size() - 1);
+  }
+  return { median(mnps), std::sqrt(variance), median(millis) };
+}
+
+auto run(const Position& p, const Options& options) -> Result {
+  switch (p.size) {
+#define X(_S)                                                                  \
+  case _S:                                                                     \
+    return run<_S>(p, options);
+    BOARD_SIZE_ITER
+#undef X
+    default:
+      PANIC("unexpected size `{}`", p.size);
+  }
+}
+
+/// One position per line, so `load_medians` can read it back without a JSON
+/// parser.
+auto write_json(const std::string& path, const Options& options,
+                const std::vector<Position>& positions,
+                const std::vector<Result>& results) -> void {
+  auto file = std::ofstream(path);
+  ASSERT(file, "cannot write `{}`", path);
+  file << fmt::format("{{\n  \"warmup\": {},\n  \"reps\": {},\n",
+                      options.warmup, options.reps);
+  file << "  \"positions\": [\n";
+  for (usize i = 0; i < positions.size(); ++i) {
+    const auto& p = positions[i];
+    const auto& r = results[i];
+    file << fmt::format(
+        "    {{\"name\": \"{}\", \"size\": {}, \"depth\": {}, \"nodes\": {}, "
+        "\"median_ms\": {:.3f}, \"median_mnps\": {:.3f}, "
+        "\"stddev_mnps\": {:.3f}}}{}\n",
+        p.name, p.size, p.depth, p.nodes, r.millis, r.median, r.stddev,
+        i + 1 < positions.size() ? "," : "");
+  }
+  file << "  ]\n}\n";
+}
+
+auto load_medians(const std::string& path) -> std::map<std::string, f64> {
+  auto file = std::ifstream(path);
+  ASSERT(file, "cannot open `{}`", path);
+  static const auto entry =
+      std::regex(R"re("name": "([^"]+)".*"median_mnps": ([0-9.]+))re");
+  auto medians = std::map<std::string, f64>();
+  auto line = std::string();
+  auto match = std::smatch();
+  while (std::getline(file, line)) {
+    if (std::regex_search(line, match, entry)) {
+      medians[match[1]] = std::stod(match[2]);
+    }
+  }
+  return medians;
+}
+
+} // namespace
+
+/// Times perft over a suite of positions. With `--compare`, every position
+/// whose median Mnps fell by more than `--threshold` percent against an
+/// earlier `--json` output is reported, and the exit status is 1.
+auto main(int argc, char** argv) -> int {
+  const auto options = parse_options(argc, argv);
+  const auto positions = load_suite(options.suite);
+  const auto baseline = options.compare.empty()
+                            ? std::map<std::string, f64>()
+                            : load_medians(options.compare);
+
+  auto results = std::vector<Result>();
+  auto regressions = 0;
+  fmt::println("{:<14} {:>5} {:>12} {:>10} {:>10} {:>8} {:>8}", "position",
+               "depth", "nodes", "ms", "Mnps", "stddev", "change");
+  for (const auto& p : positions) {
+    auto r = run(p, options);
+    results.push_back(r);
+
+    auto change = std::string();
+    if (auto it = baseline.find(p.name); it != baseline.end()) {
+      auto percent = (r.median / it->second - 1) * 100;
+      auto slower = percent < -options.threshold;
+      regressions += slower;
+      change = fmt::format("{:+.1f}%{}", percent, slower ? " SLOWER" : "");
+    }
+    fmt::println("{:<14} {:>5} {:>12} {:>10.1f} {:>10.1f} {:>8.1f} {:>8}",
+                 p.name, p.depth, p.nodes, r.millis, r.median, r.stddev,
+                 change);
+  }
+
+  if (not options.json.empty()) {
+    write_json(options.json, options, positions, results);
+  }
+  if (regressions) {
+    fmt::println("{} of {} positions slower than {}", regressions,
+                 positions.size(), options.compare);
+    return 1;
+  }
+  return 0;
+}
@@ -0,0 +1,344 @@
+#include <random>
+
+#ifdef __linux__
+#  include <linux/perf_event.h>
+#  include <sys/ioctl.h>
+#  include <sys/syscall.h>
+#  include <unistd.h>
+#endif
+
+#include "eval.hh"
+
+using namespace eris;
+
+namespace {
+
+/// Instructions retired by this thread in user space, when the kernel lets us
+/// count them.
+class InstructionCounter {
+public:
+  InstructionCounter() {
+#ifdef __linux__
+    auto attr = perf_event_attr();
+    attr.type = PERF_TYPE_HARDWARE;
+    attr.size = sizeof(attr);
+    attr.config = PERF_COUNT_HW_INSTRUCTIONS;
+    attr.disabled = 1;
+    attr.exclude_kernel = 1;
+    attr.exclude_hv = 1;
+    _fd = int(syscall(SYS_perf_event_open, &attr, 0, -1, -1, 0));
+#endif
+  }
+
+  ~InstructionCounter() {
+#ifdef __linux__
+    if (_fd >= 0) {
+      close(_fd);
+    }
+#endif
+  }
+
+  InstructionCounter(const InstructionCounter&) = delete;
+  auto operator=(const InstructionCounter&) -> InstructionCounter& = delete;
+
+  auto available() const -> bool { return _fd >= 0; }
+
+  auto start() -> void {
+#ifdef __linux__
+    ioctl(_fd, PERF_EVENT_IOC_RESET, 0);
+    ioctl(_fd, PERF_EVENT_IOC_ENABLE, 0);
+#endif
+  }
+
+  auto stop() -> u64 {
+    auto count = u64(0);
+#ifdef __linux__
+    ioctl(_fd, PERF_EVENT_IOC_DISABLE, 0);
+    if (read(_fd, &count, sizeof(count)) != sizeof(count)) {
+      count = 0;
+    }
+#endif
+    return count;
+  }
+
+private:
+  int _fd = -1;
+};
+
+/// Keeps `value` from being optimized away.
+template <typename T>
+auto keep(const T& value) -> void {
+  asm volatile("" : : "r,m"(value) : "memory");
+}
+
+struct Options {
+  std::string filter;
+  /// Best of this many rounds.
+  int rounds = 5;
+  f64 round_millis = 20;
+};
+
+class Bench {
+public:
+  explicit Bench(Options options) : _options(std::move(options)) {
+    fmt::println("{:<5} {:<22} {:>10} {:>12}", "size", "primitive", "ns/op",
+                 "instr/op");
+  }
+
+  /// Times `fn`, which does `ops` operations per call.
+  template <typename Fn>
+  auto run(int size, std::string_view name, usize ops, Fn fn) -> void {
+    if (not _options.filter.empty() and
+        name.find(_options.filter) == std::string_view::npos) {
+      return;
+    }
+
+    auto calls = usize(1);
+    while (true) {
+      auto [duration, _] = timeit<int>([&] { return repeat(calls, fn); });
+      if (duration.millis() >= _options.round_millis) {
+        break;
+      }
+      calls *= 2;
+    }
+
+    auto best_ns = std::numeric_limits<f64>::max();
+    auto best_instructions = std::numeric_limits<u64>::max();
+    for (int round = 0; round < _options.rounds; ++round) {
+      if (_counter.available()) {
+        _counter.start();
+      }
+      auto [duration, _] = timeit<int>([&] { return repeat(calls, fn); });
+      if (_counter.available()) {
+        best_instructions = std::min(best_instructions, _counter.stop());
+      }
+      best_ns = std::min(best_ns, duration.nanos());
+    }
+
+    const auto total = f64(calls * ops);
+    auto instructions = std::string("-");
+    if (_counter.available()) {
+      instructions = fmt::format("{:.1f}", f64(best_instructions) / total);
+    }
+    fmt::println("{:<5} {:<22} {:>10.2f} {:>12}",
+                 fmt::format("{}x{}", size, size), name, best_ns / total,
+                 instructions);
+  }
+
+private:
+  template <typename Fn>
+  static auto repeat(usize calls, Fn& fn) -> int {
+    for (usize i = 0; i < calls; ++i) { fn(); }
+    return 0;
+  }
+
+  Options _options;
+  InstructionCounter _counter;
+};
+
+constexpr usize INPUTS = 1024;
+
+/// Positions from random games, a few plies to most of a game in.
+template <int S>
+auto random_boards(std::mt19937& rng) -> std::vector<Board<S>> {
+  auto boards = std::vector<Board<S>>();
+  while (boards.size() < INPUTS / 8) {
+    auto board = Board<S>();
+    auto plies = rng() % (4 * S * S);
+    for (u32 ply = 0; ply < plies; ++ply) {
+      auto moves = MoveList<S>();
+      board.generate_moves(moves);
+      if (not moves.size()) {
+        break;
+      }
+      auto move = moves[rng() % moves.size()];
+      board.make_move(move);
+      if (board.road()) {
+        board.unmake_move(move);
+        break;
+      }
+    }
+    boards.push_back(board);
+  }
+  return boards;
+}
+
+template <int S>
+auto stacks(Bench& bench, std::mt19937& rng) -> void {
+  using Stack = StackOf<S>;
+  const auto tallest = std::min(max_height<S>, Stack::capacity - 1);
+
+  auto random_stack = [&](int height) {
+    auto stack = Stack();
+    for (int i = 0; i < height; ++i) { stack.push(Color(rng() & 1)); }
+    return stack;
+  };
+
+  struct Input {
+    Stack stack, other;
+    int n = 0;
+  };
+  auto inputs = std::vector<Input>();
+  for (usize i = 0; i < INPUTS; ++i) {
+    auto height = int(rng() % u32(tallest));
+    auto other = int(rng() % u32(std::min(S, tallest - height) + 1));
+    auto n = int(rng() % u32(std::min(S, height) + 1));
+    inputs.push_back({ random_stack(height), random_stack(other), n });
+  }
+
+  bench.run(S, "Stack::push", INPUTS, [&] {
+    for (auto input : inputs) {
+      input.stack.push(input.other);
+      keep(input.stack);
+    }
+  });
+  bench.run(S, "Stack::take", INPUTS, [&] {
+    for (auto input : inputs) { keep(input.stack.take(input.n)); }
+  });
+  bench.run(S, "Stack::take_back", INPUTS, [&] {
+    for (auto input : inputs) { keep(input.stack.take_back(input.n)); }
+  });
+}
+
+template <int S>
+auto spreads(Bench& bench, std::mt19937& rng) -> void {
+  // the (to_take, held) steps `Spread::push` is given for a random spread
+  auto steps = std::vector<std::vector<std::pair<int, int>>>();
+  auto patterns = std::vector<Spread<S>>();
+  for (usize i = 0; i < INPUTS; ++i) {
+    auto carry = int(rng() % S) + 1;
+    auto cuts = rng() & ((1U << (carry - 1)) - 1);
+    auto pattern = Spread<S>();
+    auto step = std::vector<std::pair<int, int>>{ { carry, S } };
+    auto held = carry;
+    for (int j = 1; j < carry; ++j) {
+      if (cuts & 1U << (j - 1)) {
+        auto drop = j - (carry - held);
+        step.emplace_back(held - drop, held);
+        held -= drop;
+      }
+    }
+    step.emplace_back(0, held);
+    for (auto [take, h] : step) { pattern.push(take, h); }
+    steps.push_back(std::move(step));
+    patterns.push_back(pattern);
+  }
+
+  bench.run(S, "Spread::push", INPUTS, [&] {
+    for (const auto& step : steps) {
+      auto pattern = Spread<S>();
+      for (auto [take, held] : step) { pattern.push(take, held); }
+      keep(pattern);
+    }
+  });
+  bench.run(S, "Spread::next", INPUTS, [&] {
+    for (auto pattern : patterns) {
+      auto sum = 0;
+      for (int take; pattern.next(take);) { sum += take; }
+      keep(sum);
+    }
+  });
+}
+
+template <int S>
+auto moves(Bench& bench, const std::vector<Board<S>>& boards,
+           std::mt19937& rng) -> void {
+  auto moves = std::vector<Move<S>>();
+  auto strings = std::vector<std::string>();
+  while (moves.size() < INPUTS) {
+    auto list = MoveList<S>();
+    boards[rng() % boards.size()].generate_moves(list);
+    if (list.size()) {
+      moves.push_back(list[rng() % list.size()]);
+      strings.push_back(moves.back().to_string());
+    }
+  }
+
+  bench.run(S, "Move(std::string)", INPUTS, [&] {
+    for (const auto& s : strings) { keep(Move<S>(s)); }
+  });
+  bench.run(S, "Move::to_string", INPUTS, [&] {
+    for (auto move : moves) { keep(move.to_string()); }
+  });
+}
+
+template <int S>
+auto bits(Bench& bench, std::mt19937& rng) -> void {
+  auto boards = std::vector<u64>();
+  for (usize i = 0; i < INPUTS; ++i) {
+    boards.push_back(rng() | u64(rng()) << 32);
+  }
+
+  bench.run(S, "BitIterator", INPUTS, [&] {
+    for (auto b : boards) {
+      auto sum = 0;
+      for (auto sq : BitboardIter<S>(b)) { sum += *sq; }
+      keep(sum);
+    }
+  });
+}
+
+template <int S>
+auto board_ops(Bench& bench, std::vector<Board<S>>& boards,
+               std::mt19937& rng) -> void {
+  // a stone goes on an empty square or a flat of each board that has one
+  auto targets = std::vector<std::pair<usize, Square<S>>>();
+  for (usize i = 0; i < boards.size(); ++i) {
+    auto blocked = boards[i].template stones<WALL>() |
+                   boards[i].template stones<CAP>();
+    auto open = nbitmask(S * S) & ~*blocked;
+    if (open) {
+      auto n = rng() % u32(popcnt(open));
+      for (; n; --n) { open &= open - 1; }
+      targets.emplace_back(i, Square<S>(lsb(open)));
+    }
+  }
+
+  bench.run(S, "put_stone+take_stone", targets.size(), [&] {
+    for (auto [i, sq] : targets) {
+      boards[i].put_stone(i % 2 ? W_FLAT : B_FLAT, sq);
+      keep(boards[i].take_stone(sq));
+    }
+  });
+  bench.run(S, "Board::road", boards.size(), [&] {
+    for (const auto& board : boards) { keep(board.road()); }
+  });
+
+  auto road_squares = std::vector<RoadSquares>();
+  for (const auto& board : boards) {
+    road_squares.push_back(board.road_squares());
+  }
+  bench.run(S, "roads", road_squares.size(), [&] {
+    for (auto board : road_squares) { keep(roads<S>(board)); }
+  });
+  bench.run(S, "evaluate", boards.size(), [&] {
+    for (const auto& board : boards) { keep(evaluate<S>(board)); }
+  });
+}
+
+template <int S>
+auto run(Bench& bench) -> void {
+  auto rng = std::mt19937(S);
+  auto boards = random_boards<S>(rng);
+  stacks<S>(bench, rng);
+  spreads<S>(bench, rng);
+  moves<S>(bench, boards, rng);
+  bits<S>(bench, rng);
+  board_ops<S>(bench, boards, rng);
+}
+
+} // namespace
+
+/// Times the primitives perft is built from on every board size. An argument
+/// keeps only the primitives whose name contains it.
+auto main(int argc, char** argv) -> int {
+  auto options = Options();
+  if (argc > 1) {
+    options.filter = argv[1];
+  }
+
+  auto bench = Bench(options);
+#define X(_S) run<_S>(bench);
+  BOARD_SIZE_ITER
+#undef X
+}
@@ -0,0 +1,16 @@
+#include "arena.hh"
+
+namespace eris {
+
+Arena::Arena(usize bytes) { resize(bytes); }
+
+auto Arena::resize(usize bytes) -> void {
+  ASSERT(bytes < MAX_BYTES, "an arena holds at most 4 GB");
+  _memory.reset();
+  // left uninitialized, only the pages the tree grows into are touched
+  _memory = std::make_unique_for_overwrite<std::byte[]>(bytes);
+  _capacity = bytes;
+  _used = ALIGN;
+}
+
+} // namespace eris
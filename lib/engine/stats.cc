@@ -0,0 +1,106 @@
+#include "stats.hh"
+
+#include <mutex>
+#include <vector>
+
+namespace eris::stats {
+
+auto Counters::merge(const Counters& other) -> void {
+  for (usize i = 0; i < COUNTER_NB; ++i) { counts[i] += other.counts[i]; }
+  for (usize i = 0; i < std::size(spreads); ++i) {
+    spreads[i] += other.spreads[i];
+  }
+  max_moves = std::max(max_moves, other.max_moves);
+}
+
+#ifdef ERIS_STATS
+namespace {
+
+struct Registry {
+  std::mutex mtx;
+  std::vector<ThreadCounters*> live;
+  /// Counters of threads that have exited.
+  Counters retired;
+};
+
+auto registry() -> Registry& {
+  static auto r = Registry();
+  return r;
+}
+
+} // namespace
+
+ThreadCounters::ThreadCounters() {
+  auto& r = registry();
+  auto lock = std::lock_guard(r.mtx);
+  r.live.push_back(this);
+}
+
+ThreadCounters::~ThreadCounters() {
+  auto& r = registry();
+  auto lock = std::lock_guard(r.mtx);
+  r.retired.merge(load());
+  std::erase(r.live, this);
+}
+
+auto ThreadCounters::load() const -> Counters {
+  auto out = Counters();
+  for (usize i = 0; i < COUNTER_NB; ++i) {
+    out.counts[i] = counts[i].load(std::memory_order_relaxed);
+  }
+  for (usize i = 0; i < std::size(spreads); ++i) {
+    out.spreads[i] = spreads[i].load(std::memory_order_relaxed);
+  }
+  out.max_moves = max_moves.load(std::memory_order_relaxed);
+  return out;
+}
+
+auto ThreadCounters::clear() -> void {
+  for (auto& count : counts) { count.store(0, std::memory_order_relaxed); }
+  for (auto& count : spreads) { count.store(0, std::memory_order_relaxed); }
+  max_moves.store(0, std::memory_order_relaxed);
+}
+
+auto collect() -> Counters {
+  auto& r = registry();
+  auto lock = std::lock_guard(r.mtx);
+  auto total = r.retired;
+  for (auto* counters : r.live) { total.merge(counters->load()); }
+  return total;
+}
+
+auto reset() -> void {
+  auto& r = registry();
+  auto lock = std::lock_guard(r.mtx);
+  r.retired = Counters();
+  for (auto* counters : r.live) { counters->clear(); }
+}
+#else
+auto collect() -> Counters { return Counters(); }
+auto reset() -> void {}
+#endif
+
+auto report(int size) -> std::string {
+  if constexpr (not enabled) {
+    return "stats are off, build with -DERIS_STATS=ON\n";
+  }
+
+  const auto total = collect();
+  auto out = std::string();
+  for (usize i = 0; i < COUNTER_NB; ++i) {
+    out += fmt::format("{:<12} {:>16}\n", counter_names[i], total.counts[i]);
+  }
+  out += fmt::format("{:<12} {:>16}\n", "max moves", total.max_moves);
+
+  out += "spreads generated per square:\n";
+  for (int rank = size - 1; rank >= 0; --rank) {
+    out += fmt::format("{:>2} ", rank + 1);
+    for (int file = 0; file < size; ++file) {
+      out += fmt::format(" {:>12}", total.spreads[rank * size + file]);
+    }
+    out += "\n";
+  }
+  return out;
+}
+
+} // namespace eris::stats
@@ -0,0 +1,96 @@
+#include "thread_pool.hh"
+
+namespace eris {
+
+ThreadPool::ThreadPool(usize nthreads)
+    : _queues(std::make_unique<Queue[]>(std::max(nthreads, 1UL))) {
+  nthreads = std::max(nthreads, 1UL);
+  for (usize i = 0; i < nthreads; ++i) {
+    _threads.emplace_back([this, i] { worker(i); });
+  }
+}
+
+ThreadPool::~ThreadPool() {
+  {
+    auto lock = std::lock_guard<std::mutex>(_mtx);
+    _stop = true;
+  }
+  _work_cv.notify_all();
+  for (auto& thread : _threads) { thread.join(); }
+}
+
+auto ThreadPool::submit(Task task) -> void {
+  auto& queue = _queues[_next++ % size()];
+  _pending += 1;
+  {
+    auto lock = std::lock_guard<std::mutex>(queue.mtx);
+    queue.tasks.push_back(std::move(task));
+  }
+  {
+    auto lock = std::lock_guard<std::mutex>(_mtx);
+    _queued += 1;
+  }
+  _work_cv.notify_one();
+}
+
+auto ThreadPool::wait() -> void {
+  auto lock = std::unique_lock<std::mutex>(_mtx);
+  _done_cv.wait(lock, [this] { return _pending == 0; });
+}
+
+auto ThreadPool::try_pop(usize id, Task& task) -> bool {
+  {
+    auto& own = _queues[id];
+    auto lock = std::lock_guard<std::mutex>(own.mtx);
+    if (not own.tasks.empty()) {
+      task = std::move(own.tasks.back());
+      own.tasks.pop_back();
+      return true;
+    }
+  }
+
+  for (usize i = 1; i < size(); ++i) {
+    auto& victim = _queues[(id + i) % size()];
+    auto lock = std::lock_guard<std::mutex>(victim.mtx);
+    if (not victim.tasks.empty()) {
+      task = std::move(victim.tasks.front());
+      victim.tasks.pop_front();
+      return true;
+    }
+  }
+
+  return false;
+}
+
+auto ThreadPool::worker(usize id) -> void {
+  for (;;) {
+    {
+      auto lock = std::unique_lock<std::mutex>(_mtx);
+      _work_cv.wait(lock, [this] { return _stop or _queued > 0; });
+      if (_stop) {
+        return;
+      }
+      // claim a task before looking for it, so the count only ever promises
+      // the other workers tasks nobody has taken yet
+      _queued -= 1;
+    }
+
+    auto task = Task();
+    if (not try_pop(id, task)) {
+      // the task was pushed to a queue this worker had already looked at,
+      // while another worker took the one it would have found
+      auto lock = std::lock_guard<std::mutex>(_mtx);
+      _queued += 1;
+      continue;
+    }
+
+    task();
+
+    if (--_pending == 0) {
+      auto lock = std::lock_guard<std::mutex>(_mtx);
+      _done_cv.notify_all();
+    }
+  }
+}
+
+} // namespace eris
@@ -0,0 +1,29 @@
+#include "timeman.hh"
+
+#include <algorithm>
+
+namespace eris {
+
+auto time_budget(i64 time, i64 inc, i64 movetime, int moves_left)
+    -> TimeBudget {
+  if (movetime > 0) {
+    auto budget = std::max(movetime - MOVE_OVERHEAD, i64(1));
+    return { budget, budget };
+  }
+  if (time <= 0) {
+    return {};
+  }
+
+  auto usable = std::max(time - MOVE_OVERHEAD, i64(1));
+  auto soft = std::min(usable / std::max(moves_left, 1) + inc * 3 / 4,
+                       usable / 2);
+  auto hard = std::min(soft * 4, usable * 3 / 4);
+  return { std::max(soft, i64(1)), std::max(hard, i64(1)) };
+}
+
+auto stability_scale(int stable) -> f64 {
+  constexpr f64 scale[] = { 1.6, 1.25, 1.0, 0.85, 0.7 };
+  return scale[std::clamp(stable, 0, int(std::size(scale)) - 1)];
+}
+
+} // namespace eris
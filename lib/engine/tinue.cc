@@ -0,0 +1,44 @@
+#include "tinue.hh"
+
+namespace eris {
+
+TinueTable::TinueTable(usize mb) { resize(mb); }
+
+auto TinueTable::resize(usize mb) -> void {
+  ASSERT(mb > 0, "the table needs at least a megabyte");
+  _count = mb * 1024 * 1024 / sizeof(Bucket);
+  _buckets.reset();
+  _buckets = std::make_unique<Bucket[]>(_count);
+}
+
+auto TinueTable::clear() -> void {
+  for (usize i = 0; i < _count; ++i) {
+    for (auto& slot : _buckets[i].slots) { slot = TinueEntry(); }
+  }
+}
+
+auto TinueTable::probe(u64 key) const -> TinueEntry {
+  for (const auto& slot : bucket(key).slots) {
+    if (slot.key == key and slot.work) {
+      return slot;
+    }
+  }
+  return { .key = key };
+}
+
+auto TinueTable::store(const TinueEntry& entry) -> void {
+  auto& slots = bucket(entry.key).slots;
+  auto* victim = &slots[0];
+  for (auto& slot : slots) {
+    if (slot.key == entry.key or not slot.work) {
+      victim = &slot;
+      break;
+    }
+    if (slot.work < victim->work) {
+      victim = &slot;
+    }
+  }
+  *victim = entry;
+}
+
+} // namespace eris
@@ -0,0 +1,102 @@
+#include "tt.hh"
+
+namespace eris {
+
+TranspositionTable::TranspositionTable(usize mb) { resize(mb); }
+
+auto TranspositionTable::resize(usize mb) -> void {
+  ASSERT(mb > 0, "the table needs at least a megabyte");
+  _mb = mb;
+  _count = mb * 1024 * 1024 / sizeof(Bucket);
+  _buckets.reset();
+  _buckets = std::make_unique<Bucket[]>(_count);
+  _age = 0;
+}
+
+auto TranspositionTable::clear() -> void {
+  for (usize i = 0; i < _count; ++i) {
+    for (auto& slot : _buckets[i].slots) {
+      slot.check.store(0, std::memory_order_relaxed);
+      slot.data.store(0, std::memory_order_relaxed);
+    }
+  }
+  _age = 0;
+}
+
+auto TranspositionTable::pack(TTEntry entry, u8 age) -> u64 {
+  return u64(entry.move) | u64(u16(entry.score)) << 16 |
+         u64(entry.depth) << 32 | u64(entry.bound) << 40 |
+         u64(age & AGE_MASK) << 42;
+}
+
+auto TranspositionTable::unpack(u64 data) -> TTEntry {
+  return {
+    .move = u16(data),
+    .score = i16(u16(data >> 16)),
+    .depth = u8(data >> 32),
+    .bound = Bound((data >> 40) & 3),
+  };
+}
+
+auto TranspositionTable::probe(u64 key) const -> std::optional<TTEntry> {
+  for (const auto& slot : bucket(key).slots) {
+    auto data = slot.data.load(std::memory_order_relaxed);
+    auto check = slot.check.load(std::memory_order_relaxed);
+    if (data and (check ^ data) == key) {
+      return unpack(data);
+    }
+  }
+  return {};
+}
+
+auto TranspositionTable::store(u64 key, TTEntry entry) -> void {
+  auto& slots = bucket(key).slots;
+
+  auto victim = &slots[0];
+  auto worst = std::numeric_limits<int>::max();
+  for (auto& slot : slots) {
+    auto data = slot.data.load(std::memory_order_relaxed);
+    auto check = slot.check.load(std::memory_order_relaxed);
+    if (not data or (check ^ data) == key) {
+      // keep what an older search found about this position if it went
+      // deeper, and its move when there is no new one
+      if (data) {
+        auto old = unpack(data);
+        if (not entry.move) {
+          entry.move = old.move;
+        }
+        if (entry.bound != BOUND_EXACT and age_of(data) == _age and
+            old.depth > entry.depth + 2) {
+          return;
+        }
+      }
+      victim = &slot;
+      break;
+    }
+
+    auto stale = (_age - age_of(data)) & AGE_MASK;
+    auto value = int(unpack(data).depth) - 8 * stale;
+    if (value < worst) {
+      worst = value;
+      victim = &slot;
+    }
+  }
+
+  auto data = pack(entry, _age);
+  victim->check.store(key ^ data, std::memory_order_relaxed);
+  victim->data.store(data, std::memory_order_relaxed);
+}
+
+auto TranspositionTable::hashfull() const -> int {
+  const auto buckets = std::min(_count, usize(1000 / SLOTS));
+  auto used = 0;
+  for (usize i = 0; i < buckets; ++i) {
+    for (const auto& slot : _buckets[i].slots) {
+      auto data = slot.data.load(std::memory_order_relaxed);
+      used += data and age_of(data) == _age;
+    }
+  }
+  return int(usize(used) * 1000 / (buckets * SLOTS));
+}
+
+} // namespace eris
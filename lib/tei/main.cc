@@ -1,13 +1,8 @@
-#include "board.hh"
-#include "engine.hh"
-#include "perft.hh"
-#include "tables.hh"
+#include "tei/tei.hh"
 
 using namespace eris;
 
-auto main(int argc, char** argv) -> int {
-  init_engine();
-
-  auto board = Board<5>();
-  board.print();
+auto main() -> int {
+  auto tei = Tei();
+  tei.tick();
 }
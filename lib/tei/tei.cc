@@ -1,43 +1,80 @@
 #include "tei/tei.hh"
 
 #include <iostream>
+#include <utility>
 
 namespace eris {
 
+constexpr usize MAX_HASH_MB = 1 << 16;
+constexpr int MAX_THREADS = 256;
+/// Both halves of the tree, each addressed by 32-bit offsets.
+constexpr usize MAX_TREE_MB = 1 << 12;
+
 Tei::Tei() {
   _thread = std::thread([&] {
     for (;;) {
       auto command = std::string();
       std::cin >> std::ws;
-      std::getline(std::cin, command);
+      if (not std::getline(std::cin, command)) {
+        _ch.send("quit");
+        return;
+      }
       _ch.send(command);
-      std::this_thread::sleep_for(chr::milliseconds(1));
     }
   });
 }
 
-Tei::~Tei() { _thread.join(); }
+Tei::~Tei() {
+  stop_search();
+  _thread.join();
+}
+
+auto Tei::stop_search() -> void {
+  if (not _searcher.joinable()) {
+    return;
+  }
+  _stopping = true;
+  _stopping.notify_all();
+  _stop_search();
+  _searcher.join();
+  _stopping = false;
+}
 
 auto Tei::tick() -> void {
+  // the command that ended a game, handled before reading the next one
+  auto pending = std::string();
   for (;;) {
-    auto command = _ch.receive();
+    auto command = pending.empty() ? _ch.receive() : std::exchange(pending, {});
     auto tokens = split(command, ' ');
     auto cmd = tokens[0];
 
-    if (cmd == "tei") {
+    if (cmd == "quit") {
+      std::exit(0);
+    } else if (cmd == "tei") {
       write("id name Eris");
       write("id author Gurpreet Singh");
+      write(fmt::format("option name Hash type spin default {} min 1 max {}",
+                        TranspositionTable::default_mb, MAX_HASH_MB));
+      write(fmt::format("option name Threads type spin default 1 min 1 max {}",
+                        MAX_THREADS));
+      write("option name Search type combo default AlphaBeta var AlphaBeta "
+            "var MCTS");
+      write(fmt::format("option name TreeSize type spin default {} min 2 "
+                        "max {}",
+                        mcts::DEFAULT_MB, MAX_TREE_MB));
       write("teiok");
     } else if (cmd == "isready") {
       write("readyok");
     } else if (cmd == "setoption") {
-      // TODO: set options
+      setoption(tokens);
     } else if (cmd == "teinewgame") {
+      _tt.clear();
+      _tinue.clear();
       auto size = std::stoi(tokens[1]);
       switch (size) {
 #define X(_S)                                                                  \
   case _S: {                                                                   \
-    teinewgame<_S>();                                                          \
+    pending = teinewgame<_S>();                                                \
   } break;
         BOARD_SIZE_ITER
 #undef X
@@ -50,4 +87,46 @@ auto Tei::tick() -> void {
   }
 }
 
+/// `setoption name <name> value <value>`
+auto Tei::setoption(const std::vector<std::string>& tokens) -> void {
+  if (tokens.size() != 5 or tokens[1] != "name" or tokens[3] != "value") {
+    fmt::println(stderr, "expected `setoption name <name> value <value>`");
+    return;
+  }
+
+  const auto& name = tokens[2];
+  const auto& value = tokens[4];
+  if (name == "Hash") {
+    auto mb = std::stoull(value);
+    if (mb < 1 or mb > MAX_HASH_MB) {
+      fmt::println(stderr, "Hash must be between 1 and {} MB", MAX_HASH_MB);
+      return;
+    }
+    _tt.resize(mb);
+  } else if (name == "Threads") {
+    auto threads = std::stoi(value);
+    if (threads < 1 or threads > MAX_THREADS) {
+      fmt::println(stderr, "Threads must be between 1 and {}", MAX_THREADS);
+      return;
+    }
+    _threads = threads;
+  } else if (name == "Search") {
+    if (value != "AlphaBeta" and value != "MCTS") {
+      fmt::println(stderr, "Search must be AlphaBeta or MCTS");
+      return;
+    }
+    _mcts = value == "MCTS";
+  } else if (name == "TreeSize") {
+    auto mb = std::stoull(value);
+    if (mb < 2 or mb > MAX_TREE_MB) {
+      fmt::println(stderr, "TreeSize must be between 2 and {} MB",
+                   MAX_TREE_MB);
+      return;
+    }
+    _tree_mb = mb;
+  } else {
+    fmt::println(stderr, "unknown option: `{}`", name);
+  }
+}
+
 } // namespace eris
@@ -1,4 +1,6 @@
+#include <algorithm>
 #include <gtest/gtest.h>
+#include <random>
 
 #include "board.hh"
 
@@ -165,6 +167,38 @@ TEST(Board, Moves) {
   EXPECT_EQ(board.stones<W_FLAT>(), 0ULL);
 }
 
+// looked up at compile time, with nothing to initialize first
+static_assert(find_in_direction(Square<5>("c3"), NORTH) == Square<5>("c4"));
+static_assert(find_in_direction(Square<5>("a1"), WEST) == Square<5>("a1"));
+static_assert(orthogonally_adjacent_squares(Square<6>("f6")) ==
+              (1 << SOUTH | 1 << WEST));
+static_assert(edge_masks<8>.top == 0xff00000000000000ULL);
+
+template <int S>
+auto check_adjacency() -> void {
+  for (int i = 0; i < S * S; ++i) {
+    const auto square = Square<S>(i);
+    auto neighbours = 0ULL;
+    for (auto direction : { NORTH, EAST, SOUTH, WEST }) {
+      auto next = find_in_direction(square, direction);
+      auto open = orthogonally_adjacent_squares(square) & 1 << direction;
+      if (open) {
+        EXPECT_EQ(next, square.move_in(direction));
+        neighbours |= next.as_board();
+      } else {
+        EXPECT_EQ(next, square);
+      }
+    }
+    EXPECT_EQ(adjacency_table<S>.neighbours[i], neighbours);
+  }
+}
+
+TEST(Board, AdjacencyTable) {
+#define X(_S) check_adjacency<_S>();
+  BOARD_SIZE_ITER
+#undef X
+}
+
 TEST(Board, SetupGameFromMoves) {
   auto board = Board<5>();
   std::vector<const char*> moves = { "a1",   "a3",  "a2",  "b1",
@@ -186,3 +220,457 @@ TEST(Board, SetupGameFromMoves) {
   EXPECT_EQ(s3.height(), 1);
   EXPECT_EQ(*s3, 0b1);
 }
+
+/// Stones on a loaded board come out of the reserves, a capstone placed
+/// cannot be placed again.
+TEST(Board, TpsReserves) {
+  auto board = Board<5>::from("x5/x5/x2,1C,x2/x5/x4,2 1 3");
+  EXPECT_EQ(board.caps_in_hand(WHITE), 0);
+  EXPECT_EQ(board.reserves(WHITE), 21);
+  EXPECT_EQ(board.caps_in_hand(BLACK), 1);
+  EXPECT_EQ(board.reserves(BLACK), 21);
+  auto moves = MoveList<5>();
+  board.generate_moves(moves);
+  EXPECT_EQ(moves.size(), 23 * 2 + 4);
+
+  board = Board<5>::from("x5/x5/x2,1212S,x2/x5/x5 1 3");
+  EXPECT_EQ(board.reserves(WHITE), 20);
+  EXPECT_EQ(board.reserves(BLACK), 20);
+}
+
+TEST(Board, UnmakeSmash) {
+  auto board = Board<5>::from("x5/x5/x5/x5/1C,2S,x3 1 3");
+  auto before = board;
+  auto move = Move<5>("a1>");
+  board.make_move(move);
+  EXPECT_EQ(board.top(Square<5>("b1")), W_CAP);
+  EXPECT_EQ(board.stones<WALL>(), 0ULL);
+  board.unmake_move(move);
+  EXPECT_TRUE(board == before);
+  EXPECT_EQ(board.top(Square<5>("b1")), B_WALL);
+}
+
+template <int S>
+auto unmake_random_games(int games, int plies) -> void {
+  auto rng = std::mt19937(S);
+  for (int game = 0; game < games; ++game) {
+    auto board = Board<S>();
+    for (int ply = 0; ply < plies and not board.road(); ++ply) {
+      auto moves = MoveList<S>();
+      board.generate_moves(moves);
+      if (not moves.size()) {
+        break;
+      }
+
+      const auto before = board;
+      for (auto move : moves) {
+        board.make_move(move);
+        ASSERT_EQ(board.hash(), board.compute_hash());
+        ASSERT_EQ(board.score(), board.compute_score());
+        board.unmake_move(move);
+        ASSERT_TRUE(board == before) << fmt::format("{}x{} {}", S, S, move);
+        ASSERT_EQ(board.hash(), before.hash());
+        ASSERT_EQ(board.score(), before.score());
+      }
+
+      board.make_move(moves[rng() % moves.size()]);
+    }
+  }
+}
+
+TEST(Board, UnmakeRandomGames) {
+#define X(_S) unmake_random_games<_S>(20, 80);
+  BOARD_SIZE_ITER
+#undef X
+}
+
+/// Every group of `c` flooded from scratch, sorted.
+template <int S>
+auto expected_groups(const Board<S>& board, Color c) -> std::vector<u64> {
+  auto rest = board.stones(FLAT, c) | board.stones(CAP, c);
+  auto groups = std::vector<u64>();
+  while (not rest.empty()) {
+    auto g = Groups<S>::flood(1ULL << lsb(*rest), *rest);
+    groups.push_back(g);
+    rest = rest & ~Bitboard(g);
+  }
+  rng::sort(groups);
+  return groups;
+}
+
+template <int S>
+auto check_groups(const Board<S>& board) -> void {
+  for (auto c : { WHITE, BLACK }) {
+    const auto groups = board.groups(c);
+    auto actual = std::vector<u64>();
+    for (auto g : groups) { actual.push_back(*g); }
+    rng::sort(actual);
+    auto expected = expected_groups(board, c);
+    ASSERT_EQ(actual, expected) << fmt::format("{}x{} {}", S, S, c);
+    auto spans = [](u64 g) { return Groups<S>::spans(g); };
+    ASSERT_EQ(groups.road(), rng::any_of(expected, spans));
+    ASSERT_EQ(board.road(c), groups.road());
+  }
+}
+
+template <int S>
+auto groups_random_games(int games, int plies) -> void {
+  auto rng = std::mt19937(S);
+  for (int game = 0; game < games; ++game) {
+    auto board = Board<S>();
+    for (int ply = 0; ply < plies and not board.road(); ++ply) {
+      auto moves = MoveList<S>();
+      board.generate_moves(moves);
+      if (not moves.size()) {
+        break;
+      }
+
+      for (auto move : moves) {
+        board.make_move(move);
+        check_groups(board);
+        board.unmake_move(move);
+        check_groups(board);
+      }
+
+      board.make_move(moves[rng() % moves.size()]);
+    }
+  }
+}
+
+TEST(Board, GroupsRandomGames) {
+#define X(_S) groups_random_games<_S>(10, 80);
+  BOARD_SIZE_ITER
+#undef X
+}
+
+TEST(Board, Road) {
+  EXPECT_TRUE(Board<5>::from("x4,1/x4,1/x4,1/x4,1/x4,1 2 5").road<WHITE>());
+  EXPECT_FALSE(Board<5>::from("x4,1/x4,1/x4,1S/x4,1/x4,1 2 5").road<WHITE>());
+  EXPECT_TRUE(Board<5>::from("x5/x5/2,2,2C,2,2/x5/x5 1 5").road<BLACK>());
+  EXPECT_FALSE(Board<5>::from("x5/x5/2,2,2C,2,2/x5/x5 1 5").road<WHITE>());
+
+  // a spread cutting a road leaves both ends as separate groups
+  auto board = Board<5>::from("x5/x5/1,1,21,1,1/x5/x5 1 5");
+  EXPECT_TRUE(board.road<WHITE>());
+  EXPECT_EQ(board.groups(WHITE).size(), 1);
+  board.make_move(Move<5>("2c3+11"));
+  EXPECT_FALSE(board.road<WHITE>());
+  EXPECT_EQ(board.groups(WHITE).size(), 3);
+  board.unmake_move(Move<5>("2c3+11"));
+  EXPECT_TRUE(board.road<WHITE>());
+  EXPECT_EQ(board.groups(WHITE).size(), 1);
+}
+
+template <int S>
+auto roads_random_boards(int boards) -> void {
+  auto rng = std::mt19937(S);
+  auto squares = std::vector<RoadSquares>();
+  auto expected = std::vector<u8>();
+  for (int i = 0; i < boards; ++i) {
+    // denser boards as `i` grows, so roads and near misses both show up
+    auto density = u32(i % 8 + 1);
+    auto board = RoadSquares();
+    for (int sq = 0; sq < S * S; ++sq) {
+      if (rng() % 10 < density) {
+        board.squares[rng() % 2] |= Square<S>(sq);
+      }
+    }
+
+    auto road = 0;
+    for (auto c : { WHITE, BLACK }) {
+      road |= Groups<S>(board.squares[c]).road() << c;
+    }
+    ASSERT_EQ(roads<S>(board), road) << fmt::format("{}x{} {}", S, S, i);
+    ASSERT_EQ((roads<S, ScalarLanes>(board)), road);
+    squares.push_back(board);
+    expected.push_back(u8(road));
+  }
+
+  auto actual = std::vector<u8>(squares.size());
+  roads<S>(squares, actual);
+  ASSERT_EQ(actual, expected);
+}
+
+TEST(Board, RoadsRandomBoards) {
+#define X(_S) roads_random_boards<_S>(2000);
+  BOARD_SIZE_ITER
+#undef X
+
+  auto board = Board<5>::from("x5/x5/2,2,2C,2,2/x5/x5 1 5");
+  EXPECT_EQ(roads<5>(board.road_squares()), 1 << BLACK);
+}
+
+/// Checks `road_placements` and `road_spreads` against making every move on
+/// positions from random games.
+template <int S>
+auto road_in_one_random_games(int games) -> void {
+  auto rng = std::mt19937(S);
+  for (int game = 0; game < games; ++game) {
+    auto board = Board<S>();
+    for (int ply = 0; ply < 4 * S * S; ++ply) {
+      auto moves = MoveList<S>();
+      board.generate_moves(moves);
+
+      for (auto c : { WHITE, BLACK }) {
+        auto expected = Bitboard();
+        if (not board.first_move() and board.reserves(c)) {
+          for (auto sq : iter<S>(~board.stones() & nbitmask(S * S))) {
+            board.put_stone(mk_stone(FLAT, c), sq);
+            if (board.road(c)) {
+              expected |= sq;
+            }
+            board.take_stone(sq);
+          }
+        }
+        ASSERT_EQ(board.road_placements(c), expected)
+            << fmt::format("{}x{} game {} ply {}", S, S, game, ply);
+      }
+
+      auto expected = std::vector<u16>();
+      for (auto move : moves) {
+        if (not move.is_place()) {
+          board.make_move(move);
+          if (board.road(~board.turn())) {
+            expected.push_back(*move);
+          }
+          board.unmake_move(move);
+        }
+      }
+      auto spreads = MoveList<S>();
+      board.road_spreads(spreads);
+      auto actual = std::vector<u16>();
+      for (auto move : spreads) { actual.push_back(*move); }
+      rng::sort(expected);
+      rng::sort(actual);
+      ASSERT_EQ(actual, expected)
+          << fmt::format("{}x{} game {} ply {}", S, S, game, ply);
+
+      // mostly spreads, so stacks grow tall
+      auto move = moves[rng() % moves.size()];
+      for (int i = 0; i < 4 and move.is_place(); ++i) {
+        move = moves[rng() % moves.size()];
+      }
+      board.make_move(move);
+      if (board.road() or not board.reserves(WHITE) or
+          not board.reserves(BLACK)) {
+        break;
+      }
+    }
+  }
+}
+
+TEST(Board, RoadInOne) {
+#define X(_S) road_in_one_random_games<_S>(40);
+  BOARD_SIZE_ITER
+#undef X
+
+  auto board = Board<5>::from("1,1,1,1,x/2,2,2,2,x/x5/x5/x5 1 5");
+  EXPECT_EQ(board.road_placements<WHITE>(), Bitboard() | Square<5>("e5"));
+  EXPECT_EQ(board.road_placements<BLACK>(), Bitboard() | Square<5>("e4"));
+}
+
+TEST(Board, HashTransposition) {
+  auto play = [](std::vector<const char*> moves) {
+    auto board = Board<5>();
+    for (auto move : moves) { board.make_move(Move<5>(move)); }
+    return board;
+  };
+
+  auto a = play({ "a1", "e5", "b2", "c3", "b3", "c2", "b3-" });
+  auto b = play({ "a1", "e5", "b3", "c2", "b2", "c3", "b3-" });
+  EXPECT_EQ(a.hash(), b.hash());
+  EXPECT_EQ(a.hash(), a.compute_hash());
+
+  auto c = play({ "a1", "e5", "b3", "c2", "b2", "c3", "b2+" });
+  EXPECT_NE(a.hash(), c.hash());
+
+  auto d = Board<5>::from("x4,1/x5/x2,2,x2/x,11,2,x2/2,x4 2 4");
+  EXPECT_EQ(a.hash(), d.hash());
+
+  // stacks that only differ in how many black stones are buried
+  EXPECT_NE(Board<3>::from("21,x2/x3/x3 1 5").hash(),
+            Board<3>::from("221,x2/x3/x3 1 5").hash());
+}
+
+#define MOVE_COUNT(S, tps, n)                                                  \
+  {                                                                            \
+    auto board = ::eris::Board<S>::from(tps);                                  \
+    auto moves = MoveList<S>();                                                \
+    board.generate_moves(moves);                                               \
+    EXPECT_EQ(moves.size(), n);                                                \
+  }
+
+TEST(Board, TallStackMoves) {
+  MOVE_COUNT(5, "x5/x,2121,x3/x2,1C,x2/x,21211,x,2S,x/x5 1 15", 122);
+  MOVE_COUNT(6, "2,x5/x,1121C,x4/x2,21212,x3/x,2S,x,1212112,x2/x6/x3,1,x2 1 20",
+             93);
+  MOVE_COUNT(8, "x8/x8/x2,1121121C,x5/x8/x3,2112121,x4/x8/x8/x8 1 30", 802);
+}
+
+TEST(Board, TallStackOps) {
+  // bit 0 of a stack is the last stone pushed, the back of `model`
+  auto rng = std::mt19937(1);
+  auto stack = Stack();
+  auto model = std::vector<Color>();
+  auto bits = [](std::span<const Color> stones) {
+    auto b = u128(0);
+    for (auto c : stones) { b = b << 1 | c; }
+    return b;
+  };
+
+  auto tallest = 0;
+  for (int i = 0; i < 20000; ++i) {
+    // alternately climb towards the capacity and fall back to empty
+    const auto grow = i / 1000 % 2 == 0;
+    const auto size = int(model.size());
+    auto n = int(rng() % 9);
+    if (rng() % 2) {
+      n = grow ? n : n / 2;
+      if (size + n < Stack::capacity) {
+        auto other = Stack();
+        for (int j = 0; j < n; ++j) {
+          auto c = Color(rng() & 1);
+          other.push(c);
+          model.push_back(c);
+        }
+        stack.push(other);
+      }
+    } else {
+      n = std::min(grow ? n / 2 : n, size);
+      if (rng() % 2) {
+        auto taken = stack.take(n);
+        EXPECT_EQ(*taken, bits(std::span(model).last(usize(n))));
+        model.resize(usize(size - n));
+      } else {
+        auto taken = stack.take_back(n);
+        EXPECT_EQ(*taken, bits(std::span(model).first(usize(n))));
+        model.erase(model.begin(), model.begin() + n);
+      }
+    }
+
+    ASSERT_EQ(stack.height(), model.size());
+    ASSERT_EQ(*stack, bits(model)) << stack.to_string();
+    tallest = std::max(tallest, int(stack.height()));
+  }
+  EXPECT_GT(tallest, 64);
+}
+
+/// Plays towards piling every stone onto the centre square, checking that
+/// every legal move unmakes cleanly, until the pile is taller than 64.
+template <int S>
+auto tall_stack_game(u32 seed) -> void {
+  auto rng = std::mt19937(seed);
+  auto board = Board<S>();
+  const auto tower = Square<S>(S / 2, S / 2);
+  auto score = [&] {
+    auto top = board.top(tower);
+    if (top and stone_type(top) != FLAT) {
+      return 0;
+    }
+    auto ours = board.template stones<FLAT>() & board.stones(~board.turn());
+    auto near = 0;
+    for (auto direction : { NORTH, EAST, SOUTH, WEST }) {
+      near += ours.get(tower.move_in(direction));
+    }
+    return board.height(tower) * 8 + near;
+  };
+
+  int placed[COLOR_NB] = {};
+  for (int ply = 0; ply < 400 and board.height(tower) <= 64; ++ply) {
+    auto moves = MoveList<S>();
+    board.generate_moves(moves);
+
+    const auto before = board;
+    auto best = std::vector<Move<S>>();
+    auto best_score = 0;
+    for (auto move : moves) {
+      board.make_move(move);
+      ASSERT_EQ(board.hash(), board.compute_hash());
+      ASSERT_EQ(board.score(), board.compute_score());
+      auto s = board.road() ? -1 : score();
+      board.unmake_move(move);
+      ASSERT_TRUE(board == before) << fmt::format("{}x{} {}", S, S, move);
+      if (s > best_score) {
+        best_score = s;
+        best.clear();
+      }
+      if (s == best_score) {
+        best.push_back(move);
+      }
+    }
+
+    ASSERT_FALSE(best.empty());
+    auto move = best[rng() % best.size()];
+    if (move.is_place()) {
+      placed[board.first_move() ? ~board.turn() : board.turn()] += 1;
+    }
+    board.make_move(move);
+  }
+  ASSERT_GT(board.height(tower), 64);
+
+  // no stone went missing above the 64th
+  int count[COLOR_NB] = {};
+  for (int i = 0; i < S * S; ++i) {
+    auto stack = board.stack(usize(i));
+    auto white = popcnt(u64(*stack)) + popcnt(u64(*stack >> 64));
+    count[WHITE] += white;
+    count[BLACK] += stack.height() - white;
+    if (auto top = board.top(usize(i))) {
+      count[stone_color(top)] += 1;
+    }
+  }
+  EXPECT_EQ(count[WHITE], placed[WHITE]);
+  EXPECT_EQ(count[BLACK], placed[BLACK]);
+}
+
+TEST(Board, TallStackGames) {
+  for (u32 seed = 0; seed < 4; ++seed) {
+    tall_stack_game<7>(seed);
+    tall_stack_game<8>(seed);
+  }
+}
+
+template <int S>
+auto count_random_games(int games, int plies) -> void {
+  auto rng = std::mt19937(S);
+  for (int game = 0; game < games; ++game) {
+    auto board = Board<S>();
+    for (int ply = 0; ply < plies and not board.road(); ++ply) {
+      auto moves = MoveList<S>();
+      board.generate_moves(moves);
+      if (not moves.size()) {
+        break;
+      }
+
+      auto expected = MoveCount();
+      for (auto move : moves) {
+        if (move.is_place()) {
+          expected.placements += 1;
+          continue;
+        }
+        auto end = move.square().move_in(move.direction(),
+                                         move.spread_pattern().size());
+        auto top = board.top(end);
+        if (top and stone_type(top) == WALL) {
+          expected.smashes += 1;
+        } else {
+          expected.spreads += 1;
+        }
+      }
+
+      auto count = board.count_moves();
+      ASSERT_EQ(count.placements, expected.placements);
+      ASSERT_EQ(count.spreads, expected.spreads);
+      ASSERT_EQ(count.smashes, expected.smashes);
+      ASSERT_EQ(count.total(), moves.size());
+
+      board.make_move(moves[rng() % moves.size()]);
+    }
+  }
+}
+
+TEST(Board, CountMoves) {
+#define X(_S) count_random_games<_S>(20, 120);
+  BOARD_SIZE_ITER
+#undef X
+}
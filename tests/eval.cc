@@ -0,0 +1,75 @@
+#include <gtest/gtest.h>
+
+#include <random>
+
+#include "eval.hh"
+
+using namespace eris;
+
+namespace {
+
+/// The same position with the colors swapped, the count after an `x` left
+/// as it is.
+auto swap_colors(std::string tps) -> std::string {
+  auto board = tps.find(' ');
+  for (usize i = 0; i < tps.size(); ++i) {
+    auto empty = i > 0 and tps[i - 1] == 'x';
+    if ((i < board and not empty) or i == board + 1) {
+      tps[i] = tps[i] == '1' ? '2' : tps[i] == '2' ? '1' : tps[i];
+    }
+  }
+  return tps;
+}
+
+} // namespace
+
+TEST(Eval, Symmetric) {
+  const auto positions = {
+    "x5/x5/x5/x5/x5 1 1",
+    "2,x4/x,1,12,x2/x2,1C,2S,x/x2,21,x2/1,x4 1 8",
+    "x,2,1,x2/x,1S,122,x2/x,2C,1112,1,x/x5/2,x3,1 2 12",
+  };
+  for (auto tps : positions) {
+    auto board = Board<5>::from(tps);
+    auto swapped = Board<5>::from(swap_colors(tps));
+    EXPECT_EQ(evaluate(board), evaluate(swapped)) << tps;
+  }
+  EXPECT_EQ(evaluate(Board<6>()), 0);
+}
+
+/// Each term favours the position it is meant to.
+TEST(Eval, Terms) {
+  auto eval = [](const char* tps) { return evaluate(Board<5>::from(tps)); };
+  // center over corner
+  EXPECT_GT(eval("x5/x5/x2,1,x2/x5/x5 1 2"), eval("x5/x5/x5/x5/1,x4 1 2"));
+  // a flat supported by its own stones over one holding captives
+  EXPECT_GT(eval("x5/x5/x2,11,x2/x5/x5 1 3"),
+            eval("x5/x5/x2,21,x2/x5/x5 1 3"));
+  // a line of flats over the same flats scattered
+  EXPECT_GT(eval("x5/x5/1,1,1,x2/x5/x5 1 4"),
+            eval("x5/1,x4/x2,1,x2/x5/x4,1 1 4"));
+  // a wall next to the other side's stones over one away from them
+  EXPECT_GT(eval("x5/x5/2,2,1S,x2/x5/x5 1 4"),
+            eval("x5/x5/2,2,x2,1S/x5/x5 1 4"));
+}
+
+/// The bit tricks of `Groups::extent` against counting ranks and files.
+TEST(Eval, Extent) {
+  auto rng = std::mt19937(8);
+  for (int i = 0; i < 1000; ++i) {
+    auto g = (u64(rng()) << 32 | rng()) & (u64(rng()) << 32 | rng());
+    auto files = 0, ranks = 0;
+    for (int j = 0; j < 8; ++j) {
+      ranks += (g >> (8 * j) & 0xff) != 0;
+      files += (g & 0x0101010101010101ULL << j) != 0;
+    }
+    ASSERT_EQ(Groups<8>::extent(g), std::max(files, ranks)) << g;
+    g &= nbitmask(25);
+    ranks = files = 0;
+    for (int j = 0; j < 5; ++j) {
+      ranks += (g >> (5 * j) & 0x1f) != 0;
+      files += (g & 0x108421ULL << j) != 0;
+    }
+    ASSERT_EQ(Groups<5>::extent(g), std::max(files, ranks)) << g;
+  }
+}
@@ -0,0 +1,122 @@
+#include <gtest/gtest.h>
+
+#include "mcts.hh"
+
+using namespace eris;
+
+namespace {
+
+template <int S>
+auto legal(const Board<S>& board, Move<S> move) -> bool {
+  auto moves = MoveList<S>();
+  board.generate_moves(moves);
+  return rng::find(moves, move) != moves.end();
+}
+
+} // namespace
+
+TEST(Arena, Allocate) {
+  auto arena = Arena(64);
+  auto a = arena.allocate(3);
+  auto b = arena.allocate(20);
+  EXPECT_NE(a, 0);
+  EXPECT_EQ(b % Arena::ALIGN, 0);
+  EXPECT_GE(b, a + 3);
+  EXPECT_EQ(arena.allocate(64), 0);
+  arena.clear();
+  EXPECT_EQ(arena.used(), Arena::ALIGN);
+}
+
+TEST(Mcts, RoadInOne) {
+  auto board = Board<5>::from("1,1,1,1,x/2,2,2,2,x/x5/x5/x5 1 5");
+  auto tree = Mcts<5>(16);
+  auto best = tree.go(board, { .nodes = 2000 });
+  EXPECT_EQ(best.square(), Square<5>("e5"));
+  EXPECT_NE(best.stone(), WALL);
+}
+
+TEST(Mcts, Report) {
+  auto board = Board<6>::from("x6/x6/x2,1,2,x2/x2,2,1,x2/x6/x6 1 3");
+  const auto before = board;
+  auto tree = Mcts<6>(16);
+  auto reports = 0;
+  auto best = tree.go(board, { .nodes = 3000 }, [&](const SearchInfo<6>& info) {
+    reports += 1;
+    EXPECT_EQ(info.nodes, 3000);
+    ASSERT_FALSE(info.pv.empty());
+    EXPECT_TRUE(legal(board, info.pv[0]));
+  });
+  EXPECT_EQ(reports, 1);
+  EXPECT_TRUE(legal(board, best));
+  EXPECT_TRUE(board == before);
+  EXPECT_EQ(tree.root_visits(), 3000);
+}
+
+/// The subtree of a position two moves on is searched further, anything else
+/// starts over.
+TEST(Mcts, Reuse) {
+  auto board = Board<6>::from("x6/x6/x2,1,2,x2/x2,2,1,x2/x6/x6 1 3");
+  auto tree = Mcts<6>(16);
+  auto best = tree.go(board, { .nodes = 5000 });
+  board.make_move(best);
+  auto reply = tree.go(board, { .nodes = 1 });
+  EXPECT_GT(tree.root_visits(), 1);
+
+  board.make_move(reply);
+  tree.go(board, { .nodes = 1000 });
+  EXPECT_GT(tree.root_visits(), 1000);
+
+  tree.go(Board<6>::from("x6/x6/x2,2,1,x2/x2,1,2,x2/x6/x6 1 3"),
+          { .nodes = 100 });
+  EXPECT_EQ(tree.root_visits(), 100);
+}
+
+/// A tree too small for the search still plays a move.
+TEST(Mcts, Full) {
+  auto board = Board<6>::from("x6/x6/x2,1,2,x2/x2,2,1,x2/x6/x6 1 3");
+  auto tree = Mcts<6>(2);
+  auto hashfull = 0;
+  auto best = tree.go(board, { .nodes = 100000 },
+                      [&](const SearchInfo<6>& info) {
+                        hashfull = info.hashfull;
+                      });
+  EXPECT_TRUE(legal(board, best));
+  EXPECT_GT(hashfull, 900);
+  EXPECT_LE(hashfull, 1000);
+}
+
+/// Threads playing out one tree leave every edge with as many visits as
+/// playouts went through it, their virtual losses taken back.
+TEST(Mcts, Threads) {
+  auto board = Board<5>::from("1,1,1,1,x/2,2,2,2,x/x5/x5/x5 1 5");
+  auto tree = Mcts<5>(16, 4);
+  auto best = tree.go(board, { .nodes = 20000 });
+  EXPECT_EQ(best.square(), Square<5>("e5"));
+  EXPECT_GE(tree.nodes(), 20000);
+  EXPECT_LE(tree.nodes(), 20000 + 4 * mcts::BATCH);
+  EXPECT_EQ(tree.root_visits(), tree.nodes());
+
+  board.make_move(best);
+  tree.set_threads(2);
+  auto reply = tree.go(board, { .nodes = 1000 });
+  EXPECT_TRUE(legal(board, reply));
+}
+
+/// A stop before a search starts ends it, one for a search that is over
+/// leaves the next its playouts.
+TEST(Mcts, Stop) {
+  auto board = Board<5>::from("x5/x5/x2,1,x2/x2,2,x2/x5 1 3");
+  auto tree = Mcts<5>(16);
+  tree.stop();
+  auto best = tree.go(board, { .infinite = true });
+  EXPECT_LE(tree.nodes(), mcts::BATCH);
+  EXPECT_TRUE(legal(board, best));
+
+  auto search = tree.searches();
+  tree.stop(search);
+  tree.go(board, { .nodes = 2000 });
+  tree.stop(search);
+  best = tree.go(board, { .nodes = 2000 });
+  EXPECT_GE(tree.nodes(), 2000);
+  EXPECT_TRUE(legal(board, best));
+}
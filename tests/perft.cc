@@ -69,3 +69,62 @@ TEST(Perft, Board8) {
     EXPECT_EQ(perft<8>(board, depth), perf_results[depth]);
   }
 }
+
+template <int S>
+auto perft_parallel(int depth) -> void {
+  auto pool = ThreadPool(4);
+  auto board = Board<S>();
+  auto serial = perft<S>(board, depth);
+  EXPECT_EQ(perft<S>(board, depth, pool), serial);
+
+  auto moves = MoveList<S>();
+  board.generate_moves(moves);
+  auto counts = perft_split<S>(board, depth, pool);
+  ASSERT_EQ(counts.size(), moves.size());
+  for (usize i = 0; i < moves.size(); ++i) {
+    board.make_move(moves[i]);
+    EXPECT_EQ(counts[i], perft<S>(board, depth - 1));
+    board.unmake_move(moves[i]);
+  }
+}
+
+TEST(Perft, Parallel) {
+  perft_parallel<3>(5);
+  perft_parallel<4>(4);
+  perft_parallel<5>(4);
+  perft_parallel<6>(3);
+  perft_parallel<7>(3);
+  perft_parallel<8>(3);
+}
+
+TEST(Perft, Hashed) {
+  auto table = PerftTable(16);
+  auto board3 = Board<3>();
+  EXPECT_EQ(perft<3>(board3, 7, table), 52364896);
+  auto board4 = Board<4>();
+  EXPECT_EQ(perft<4>(board4, 6, table), 181954216);
+  auto board5 = Board<5>();
+  EXPECT_EQ(perft<5>(board5, 5, table), 187855252);
+  auto board6 = Board<6>();
+  EXPECT_EQ(perft<6>(board6, 4, table), 13586048);
+
+  // a tiny table keeps overwriting entries and must still be exact
+  auto small = PerftTable(0);
+  EXPECT_EQ(perft<5>(board5, 4, small), 2999784);
+}
+
+TEST(Perft, Stats) {
+  if constexpr (not stats::enabled) {
+    GTEST_SKIP() << "built without ERIS_STATS";
+  }
+
+  // moves at depth 1 are counted, not made
+  stats::reset();
+  auto board = Board<5>();
+  EXPECT_EQ(perft<5>(board, 3), 43320);
+  const auto total = stats::collect();
+  const auto& counts = total.counts;
+  EXPECT_EQ(counts[stats::MAKE_PLACE] + counts[stats::MAKE_SPREAD], 25 + 600);
+  EXPECT_EQ(counts[stats::UNMAKE], 25 + 600);
+  EXPECT_EQ(counts[stats::GENERATE], 1 + 25);
+}
@@ -0,0 +1,149 @@
+#include <gtest/gtest.h>
+
+#include "search.hh"
+
+using namespace eris;
+
+namespace {
+
+template <int S>
+auto legal(const Board<S>& board, Move<S> move) -> bool {
+  auto moves = MoveList<S>();
+  board.generate_moves(moves);
+  return rng::find(moves, move) != moves.end();
+}
+
+} // namespace
+
+TEST(Search, RoadInOne) {
+  auto board = Board<5>::from("1,1,1,1,x/2,2,2,2,x/x5/x5/x5 1 5");
+  auto tt = TranspositionTable(1);
+  auto search = Search<5>(tt);
+  auto score = Score();
+  auto best = search.go(board, { .depth = 4 }, [&](const SearchInfo<5>& info) {
+    score = info.score;
+  });
+  EXPECT_EQ(best.square(), Square<5>("e5"));
+  EXPECT_NE(best.stone(), WALL);
+  EXPECT_EQ(moves_to_win(score), 1);
+}
+
+/// White's only capstone is on the board, so the search cannot place one,
+/// though it would if loading the position left it in hand.
+TEST(Search, CapstonePlaced) {
+  auto board =
+      Board<5>::from("x2,1,2S,x/x2,1C,21,21/x,1,x2,12/x2,1,2,x/x3,2,x 1 8");
+  auto tt = TranspositionTable(1);
+  auto search = Search<5>(tt);
+  auto best = search.go(board, { .depth = 3 });
+  EXPECT_TRUE(legal(board, best));
+  EXPECT_FALSE(best.is_place() and best.stone() == CAP) << best.to_string();
+}
+
+TEST(Search, BlocksRoad) {
+  auto board = Board<5>::from("1,1,1,1,x/2,x,x,x,x/x5/x5/x5 2 5");
+  auto tt = TranspositionTable(1);
+  auto search = Search<5>(tt);
+  auto best = search.go(board, { .depth = 3 });
+
+  // placing on e5 or covering a5 with a4 both stop the road
+  board.make_move(best);
+  auto replies = MoveList<5>();
+  board.generate_moves(replies);
+  for (auto reply : replies) {
+    board.make_move(reply);
+    EXPECT_FALSE(board.road(WHITE))
+        << best.to_string() << " " << reply.to_string();
+    board.unmake_move(reply);
+  }
+}
+
+TEST(Search, Limits) {
+  auto board = Board<6>::from("x6/x6/x2,1,2,x2/x2,2,1,x2/x6/x6 1 3");
+  const auto before = board;
+
+  auto tt = TranspositionTable(1);
+  auto search = Search<6>(tt);
+  auto depths = std::vector<int>();
+  auto best = search.go(board, { .depth = 3 }, [&](const SearchInfo<6>& info) {
+    depths.push_back(info.depth);
+    ASSERT_FALSE(info.pv.empty());
+    EXPECT_TRUE(legal(board, info.pv[0]));
+  });
+  EXPECT_EQ(depths, (std::vector<int>{ 1, 2, 3 }));
+  EXPECT_TRUE(legal(board, best));
+  EXPECT_TRUE(board == before);
+
+  best = search.go(board, { .nodes = 5000 });
+  EXPECT_TRUE(legal(board, best));
+  EXPECT_LT(search.nodes(), 5000 + max_moves<6>);
+  EXPECT_TRUE(board == before);
+}
+
+TEST(Search, Threads) {
+  auto board = Board<6>::from("x6/x6/x2,1,2,x2/x2,2,1,x2/x6/x6 1 3");
+  auto tt = TranspositionTable(1);
+  auto search = Search<6>(tt, 4);
+  auto best = search.go(board, { .depth = 4 });
+  EXPECT_TRUE(legal(board, best));
+
+  best = search.go(board, { .nodes = 20000 });
+  EXPECT_TRUE(legal(board, best));
+  EXPECT_LT(search.nodes(), 20000 + 4 * 1024 + max_moves<6>);
+
+  auto road = Board<5>::from("1,1,1,1,x/2,2,2,2,x/x5/x5/x5 1 5");
+  auto search5 = Search<5>(tt, 4);
+  EXPECT_EQ(search5.go(road, { .depth = 3 }).square(), Square<5>("e5"));
+}
+
+TEST(Search, TimeBudget) {
+  EXPECT_EQ(time_budget(0, 0, 0, 30).hard, 0);
+
+  auto fixed = time_budget(0, 0, 500, 30);
+  EXPECT_EQ(fixed.soft, 500 - MOVE_OVERHEAD);
+  EXPECT_EQ(fixed.hard, 500 - MOVE_OVERHEAD);
+
+  // fewer moves left, more time per move, never the whole clock
+  auto early = time_budget(60000, 0, 0, 40);
+  auto late = time_budget(60000, 0, 0, 4);
+  EXPECT_LT(early.soft, late.soft);
+  EXPECT_LE(early.soft, early.hard);
+  EXPECT_LT(late.hard, 60000);
+  EXPECT_GT(time_budget(60000, 1000, 0, 40).soft, early.soft);
+
+  auto board = Board<6>();
+  EXPECT_GT(moves_left(board), moves_left(Board<6>::from(
+                                   "1,1,1,1,1,1/2,2,2,2,2,2/1,1,1,1,1,1/"
+                                   "2,2,2,2,2,2/1,1,1,1,1,x/2,2,x4 1 15")));
+}
+
+TEST(Search, Movetime) {
+  auto board = Board<6>::from("x6/x6/x2,1,2,x2/x2,2,1,x2/x6/x6 1 3");
+  auto tt = TranspositionTable(1);
+  auto search = Search<6>(tt);
+  auto [duration, best] = timeit<Move<6>>(
+      [&] { return search.go(board, { .movetime = 100 }); });
+  EXPECT_TRUE(legal(board, best));
+  EXPECT_LT(duration.millis(), 100 + 20);
+}
+
+TEST(Search, Tinue) {
+  // d3 threatens roads on both e3 and d1
+  auto board =
+      Board<5>::from("2,2,x,1,x/x,2,x,1,x/1,1,1,x2/x3,1,x/2,2,x3 1 6");
+  auto tt = TranspositionTable(1);
+  auto tinue = TinueTable(1);
+  auto search = Search<5>(tt, 1, &tinue);
+  auto scores = std::vector<Score>();
+  auto first = Move<5>::none();
+  auto best = search.go(board, { .depth = 6 }, [&](const SearchInfo<5>& info) {
+    scores.push_back(info.score);
+    first = info.pv[0];
+  });
+  // the solver's proof, no iteration searched
+  ASSERT_EQ(scores.size(), 1);
+  EXPECT_TRUE(is_win(scores[0]));
+  EXPECT_GT(scores[0], 0);
+  EXPECT_EQ(best, first);
+  EXPECT_TRUE(legal(board, best));
+}
@@ -0,0 +1,12 @@
+# Feeds the commands in `INPUT` to the engine at `TEI` and prints what it
+# writes, failing if it has not quit within `TIMEOUT` seconds.
+execute_process(
+  COMMAND ${TEI}
+  INPUT_FILE ${INPUT}
+  OUTPUT_VARIABLE output
+  RESULT_VARIABLE result
+  TIMEOUT ${TIMEOUT})
+message("${output}")
+if (NOT result EQUAL 0)
+  message(FATAL_ERROR "`${TEI}` < `${INPUT}`: ${result}")
+endif()
@@ -0,0 +1,83 @@
+#include <gtest/gtest.h>
+
+#include "tinue.hh"
+
+using namespace eris;
+
+namespace {
+
+/// Plays `line` on `board` and checks the side to move at the start won by a
+/// road with the last move, threatening one after each move before it.
+template <int S>
+auto check_tinue(Board<S> board, const std::vector<Move<S>>& line) -> void {
+  ASSERT_EQ(line.size() % 2, 1);
+  const auto attacker = board.turn();
+  for (usize i = 0; i < line.size(); ++i) {
+    EXPECT_FALSE(board.road(attacker));
+    board.make_move(line[i]);
+    if (i % 2 == 0 and i + 1 < line.size()) {
+      auto spreads = MoveList<S>();
+      board.road_spreads(attacker, spreads);
+      EXPECT_TRUE(not board.road_placements(attacker).empty() or
+                  spreads.size());
+    }
+  }
+  EXPECT_TRUE(board.road(attacker));
+}
+
+} // namespace
+
+TEST(Tinue, RoadInOne) {
+  auto board = Board<5>::from("2,2,x3/x5/1,1,1,1,x/x5/2,2,x3 1 5");
+  auto table = TinueTable(1);
+  auto solver = TinueSolver<5>(table);
+  EXPECT_EQ(solver.solve(board), TINUE_PROVEN);
+  auto pv = solver.pv();
+  ASSERT_EQ(pv.size(), 1);
+  EXPECT_EQ(pv[0].square(), Square<5>("e3"));
+  check_tinue(board, pv);
+}
+
+/// d3 threatens both e3 and d1, black can only take one of them.
+TEST(Tinue, Fork) {
+  auto board =
+      Board<5>::from("2,2,x,1,x/x,2,x,1,x/1,1,1,x2/x3,1,x/2,2,x3 1 6");
+  const auto before = board;
+  auto table = TinueTable(1);
+  auto solver = TinueSolver<5>(table);
+  EXPECT_EQ(solver.solve(board), TINUE_PROVEN);
+  EXPECT_TRUE(board == before);
+  // proof numbers find a tinuë, not necessarily the shortest one
+  auto pv = solver.pv();
+  ASSERT_GE(pv.size(), 3);
+  check_tinue(board, pv);
+
+  // black to move in the same position blocks, or has nothing to threaten
+  board = Board<5>::from("2,2,x,1,x/x,2,x,1,x/1,1,1,x2/x3,1,x/2,2,x3 2 6");
+  EXPECT_EQ(solver.solve(board), TINUE_DISPROVEN);
+}
+
+TEST(Tinue, NoThreats) {
+  auto table = TinueTable(1);
+  auto solver = TinueSolver<6>(table);
+  EXPECT_EQ(solver.solve(Board<6>()), TINUE_UNKNOWN);
+  auto board = Board<6>::from("x6/x6/x2,1,2,x2/x2,2,1,x2/x6/x6 1 3");
+  EXPECT_EQ(solver.solve(board), TINUE_DISPROVEN);
+  EXPECT_TRUE(solver.pv().empty());
+}
+
+/// Both sides attacking from the same stones on one table keep apart, the
+/// second search leaves the first one's proof.
+TEST(Tinue, BothAttackers) {
+  const auto stones = std::string("2,2,x,1,x/x,2,x,1,x/1,1,1,x2/x3,1,x/2,2,x3");
+  auto white = Board<5>::from(stones + " 1 6");
+  auto black = Board<5>::from(stones + " 2 6");
+  auto table = TinueTable(1);
+  auto attacker = TinueSolver<5>(table);
+  auto other = TinueSolver<5>(table);
+  EXPECT_EQ(attacker.solve(white), TINUE_PROVEN);
+  EXPECT_EQ(other.solve(black), TINUE_DISPROVEN);
+  auto pv = attacker.pv();
+  ASSERT_GE(pv.size(), 3);
+  check_tinue(white, pv);
+}
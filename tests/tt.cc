@@ -0,0 +1,89 @@
+#include <gtest/gtest.h>
+
+#include <thread>
+
+#include "search.hh"
+
+using namespace eris;
+
+TEST(TranspositionTable, StoreProbe) {
+  auto tt = TranspositionTable(1);
+  EXPECT_FALSE(tt.probe(42));
+
+  tt.store(42, { .move = 0x1234, .score = -517, .depth = 9,
+                 .bound = BOUND_LOWER });
+  auto entry = tt.probe(42);
+  ASSERT_TRUE(entry);
+  EXPECT_EQ(entry->move, 0x1234);
+  EXPECT_EQ(entry->score, -517);
+  EXPECT_EQ(entry->depth, 9);
+  EXPECT_EQ(entry->bound, BOUND_LOWER);
+
+  // a shallower entry without a move keeps the old move
+  tt.store(42, { .move = 0, .score = 3, .depth = 8, .bound = BOUND_EXACT });
+  entry = tt.probe(42);
+  ASSERT_TRUE(entry);
+  EXPECT_EQ(entry->move, 0x1234);
+  EXPECT_EQ(entry->score, 3);
+
+  tt.clear();
+  EXPECT_FALSE(tt.probe(42));
+}
+
+TEST(TranspositionTable, Hashfull) {
+  auto tt = TranspositionTable(1);
+  EXPECT_EQ(tt.hashfull(), 0);
+  for (u64 key = 1; key < 200000; ++key) {
+    tt.store(key * 0x9e3779b97f4a7c15ULL,
+             { .move = 1, .score = 0, .depth = 1, .bound = BOUND_EXACT });
+  }
+  EXPECT_GT(tt.hashfull(), 900);
+  // entries of an earlier search do not count
+  tt.new_search();
+  EXPECT_EQ(tt.hashfull(), 0);
+}
+
+TEST(TranspositionTable, WinScores) {
+  for (auto ply : { 0, 3, 10 }) {
+    for (auto score : { WIN - 12, -(WIN - 15), Score(250), Score(-40) }) {
+      EXPECT_EQ(score_from_tt(score_to_tt(score, ply), ply), score);
+    }
+  }
+  // a win 5 plies after a node at ply 3 is the same win at ply 7
+  EXPECT_EQ(score_from_tt(score_to_tt(WIN - 8, 3), 7), WIN - 12);
+}
+
+/// Threads store entries derived from their keys into a tiny table at once,
+/// every hit has to be one of them whole.
+TEST(TranspositionTable, Concurrent) {
+  auto tt = TranspositionTable(1);
+  auto entry_of = [](u64 key, u64 salt) -> TTEntry {
+    return {
+      // never 0, which would keep the move already stored
+      .move = u16((key ^ salt) | 0x8000),
+      .score = i16(u16(key >> 16)),
+      .depth = u8(salt),
+      .bound = BOUND_EXACT,
+    };
+  };
+
+  constexpr u64 keys = 1 << 17;
+  auto bad = std::atomic<int>(0);
+  auto threads = std::vector<std::thread>();
+  for (u64 t = 0; t < 4; ++t) {
+    threads.emplace_back([&, t] {
+      for (u64 i = 0; i < 4 * keys; ++i) {
+        auto key = ((i * 7 + t) % keys + 1) * 0x9e3779b97f4a7c15ULL;
+        tt.store(key, entry_of(key, t));
+        if (auto hit = tt.probe(key)) {
+          auto salt = u64(hit->depth);
+          auto want = entry_of(key, salt);
+          bad += salt >= 4 or hit->move != want.move or
+                 hit->score != want.score;
+        }
+      }
+    });
+  }
+  for (auto& thread : threads) { thread.join(); }
+  EXPECT_EQ(bad, 0);
+}